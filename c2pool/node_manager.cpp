@@ -1,6 +1,7 @@
 #include "node_manager.h"
 
 #include <boost/asio.hpp>
+#include <algorithm>
 
 #include <libnet/p2p_node.h>
 #include <libnet/coind_node.h>
@@ -22,7 +23,16 @@ namespace c2pool::libnet
     void NodeManager::run()
     {
         LOG_INFO << "Making asio io_context in NodeManager...";
-        _context = make_shared<boost::asio::io_context>(4);
+        //node logic stays in one thread: CoindNode, ShareTracker, AddrStore aren't thread-safe.
+        _context = make_shared<boost::asio::io_context>(1);
+
+        auto hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+        int io_threads = _config->io_threads > 0 ? _config->io_threads : hardware_threads;
+        int compute_threads = _config->compute_threads > 0 ? _config->compute_threads : hardware_threads;
+        LOG_INFO << "Starting " << io_threads << " io threads and " << compute_threads << " compute threads...";
+        _socket_context = make_shared<boost::asio::io_context>(io_threads);
+        start_socket_threads(io_threads);
+        _compute_pool = make_shared<boost::asio::thread_pool>(compute_threads);
 
         //0:    COIND
         LOG_INFO << "Init Coind...";
@@ -34,16 +44,21 @@ namespace c2pool::libnet
         //2:    ShareStore
         LOG_INFO << "ShareStore initialization...";
         _share_store = std::make_shared<c2pool::shares::ShareStore>("dgb"); //TODO: init
+        LOG_INFO << "Loaded PoW of " << _share_store->load_pow_cache(_parent_net->pow_cache) << " headers";
+        _pow_cache_timer = std::make_shared<boost::asio::deadline_timer>(*_context);
+        save_pow_cache();
         //Init work:
         //3:    ShareTracker
         LOG_INFO << "ShareTracker initialization...";
         _tracker = std::make_shared<ShareTracker>(_net, _parent_net);
+        //share prechecks (PoW) in compute pool by batches of scrypt lanes, results in node context.
+        _tracker->verifier->start(_compute_pool, _context, compute_threads, _parent_net->pow_lanes());
         //3.1:  Save shares every 60 seconds
         //TODO: timer in _tracker constructor
 
         //4:    CoindNode
         LOG_INFO << "CoindNode initialization...";
-        _coind_node = std::make_shared<c2pool::libnet::CoindNode>(_context, _parent_net, _coind, _tracker);
+        _coind_node = std::make_shared<c2pool::libnet::CoindNode>(_context, _parent_net, _coind, _tracker, _compute_pool);
         //4.1:  CoindNode.start?
         LOG_INFO << "CoindNode starting...";
         coind_node()->start();
@@ -55,7 +70,7 @@ namespace c2pool::libnet
         //5.1:  Bootstrap_addrs
         //5.2:  Parse CLI args for addrs
         //6:    P2PNode
-        _p2pnode = std::make_shared<c2pool::libnet::p2p::P2PNode>(_context, _net, _config, _addr_store, _coind_node, _tracker);
+        _p2pnode = std::make_shared<c2pool::libnet::p2p::P2PNode>(_context, _net, _config, _addr_store, _coind_node, _tracker, _socket_context, _compute_pool);
         //6.1:  P2PNode.start?
         p2pNode()->start();
         //7:    Save addrs every 60 seconds
@@ -71,6 +86,56 @@ namespace c2pool::libnet
         //...success!
         _is_loaded = true;
         _context->run();
+
+        stop_socket_threads();
+        _compute_pool->join();
+    }
+
+    void NodeManager::start_socket_threads(int count)
+    {
+        //socket context runs until stop_socket_threads(), even without connections.
+        auto work = std::make_shared<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(_socket_context->get_executor());
+        for (int i = 0; i < count; i++)
+        {
+            _socket_threads.emplace_back([context = _socket_context, work]()
+                                         { context->run(); });
+        }
+    }
+
+    void NodeManager::stop_socket_threads()
+    {
+        _socket_context->stop();
+        for (auto &thread : _socket_threads)
+        {
+            thread.join();
+        }
+        _socket_threads.clear();
+    }
+
+    void NodeManager::save_pow_cache()
+    {
+        _pow_cache_timer->expires_from_now(boost::posix_time::seconds(60));
+        _pow_cache_timer->async_wait([this](const boost::system::error_code &ec)
+                                     {
+                                         if (ec)
+                                             return;
+                                         if (!_parent_net->pow_cache.is_dirty())
+                                         {
+                                             save_pow_cache();
+                                             return;
+                                         }
+                                         //file is written in compute pool, timer restarts in node context after it.
+                                         boost::asio::post(*_compute_pool, [this]()
+                                         {
+                                             bool saved = _share_store->save_pow_cache(_parent_net->pow_cache);
+                                             boost::asio::post(*_context, [this, saved]()
+                                             {
+                                                 if (!saved)
+                                                     LOG_WARNING << "Failed to save PoW cache";
+                                                 save_pow_cache();
+                                             });
+                                         });
+                                     });
     }
 
     bool NodeManager::is_loaded() const
@@ -83,6 +148,16 @@ namespace c2pool::libnet
         return _context;
     }
 
+    shared_ptr<boost::asio::io_context> NodeManager::socket_context() const
+    {
+        return _socket_context;
+    }
+
+    shared_ptr<boost::asio::thread_pool> NodeManager::compute_pool() const
+    {
+        return _compute_pool;
+    }
+
     shared_ptr<c2pool::Network> NodeManager::net() const
     {
         return _net;
@@ -148,6 +223,8 @@ namespace c2pool::libnet
     }
 
     create_set_method(boost::asio::io_context, _context);
+    create_set_method(boost::asio::io_context, _socket_context);
+    create_set_method(boost::asio::thread_pool, _compute_pool);
     create_set_method(c2pool::Network, _net);
     create_set_method(coind::ParentNetwork, _parent_net);
     create_set_method(c2pool::dev::coind_config, _config);
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <thread>
+#include <vector>
 #include <networks/network.h>
 #include <libdevcore/config.h>
 #include <libdevcore/addrStore.h>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/executor_work_guard.hpp>
 
 using std::shared_ptr;
 
@@ -57,6 +62,8 @@ namespace c2pool::libnet
 
     public:
         shared_ptr<boost::asio::io_context> context() const;
+        shared_ptr<boost::asio::io_context> socket_context() const;
+        shared_ptr<boost::asio::thread_pool> compute_pool() const;
         shared_ptr<c2pool::Network> net() const;
         shared_ptr<coind::ParentNetwork> parent_net() const;
         shared_ptr<c2pool::dev::coind_config> config() const;
@@ -70,7 +77,12 @@ namespace c2pool::libnet
         shared_ptr<coind::jsonrpc::StratumNode> stratum() const;
 
     protected:
+        //node logic and timers: run() thread.
         shared_ptr<boost::asio::io_context> _context;
+        //I/O of p2p sockets: config()->io_threads threads.
+        shared_ptr<boost::asio::io_context> _socket_context;
+        //share prechecks (PoW), loading of shares, PoW cache saving: config()->compute_threads threads.
+        shared_ptr<boost::asio::thread_pool> _compute_pool;
         shared_ptr<c2pool::Network> _net;
         shared_ptr<coind::ParentNetwork> _parent_net;
         shared_ptr<c2pool::dev::coind_config> _config;
@@ -85,6 +97,14 @@ namespace c2pool::libnet
 
     private:
         std::atomic<bool> _is_loaded = false;
+
+        std::vector<std::thread> _socket_threads;
+        void start_socket_threads(int count);
+        void stop_socket_threads();
+
+        //PoW cache saved with ShareStore every 60 seconds.
+        shared_ptr<boost::asio::deadline_timer> _pow_cache_timer;
+        void save_pow_cache();
     };
 } // namespace c2pool::libnet
 
@@ -100,6 +120,8 @@ namespace c2pool::libnet
 
     public:
         create_set_method(boost::asio::io_context, _context);
+        create_set_method(boost::asio::io_context, _socket_context);
+        create_set_method(boost::asio::thread_pool, _compute_pool);
         create_set_method(c2pool::Network, _net);
         create_set_method(coind::ParentNetwork, _parent_net);
         create_set_method(c2pool::dev::coind_config, _config);
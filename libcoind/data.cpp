@@ -1,9 +1,11 @@
 #include "data.h"
 
 #include <sstream>
+#include <array>
 
 #include "transaction.h"
 #include <btclibs/uint256.h>
+#include <btclibs/crypto/common.h>
 #include <univalue.h>
 
 namespace coind::data
@@ -28,87 +30,267 @@ namespace coind::data
         return false;
     }
 
+    //Knuth's algorithm D on 32-bit little-endian digits: q[0..m-n] = u / v, r[0..n-1] = u % v; m >= n, v[n - 1] != 0.
+    //arith_uint256::operator/ is bit by bit (256 shift-subtract steps).
+    static void divmod_digits(const uint32_t *u, int m, const uint32_t *v, int n, uint32_t *q, uint32_t *r)
+    {
+        if (n == 1)
+        {
+            uint64_t k = 0;
+            for (int j = m - 1; j >= 0; j--)
+            {
+                uint64_t cur = (k << 32) | u[j];
+                q[j] = cur / v[0];
+                k = cur % v[0];
+            }
+            r[0] = k;
+            return;
+        }
+
+        //normalize: top bit of divisor set.
+        int s = __builtin_clz(v[n - 1]);
+        uint32_t vn[8], un[10];
+        for (int i = n - 1; i > 0; i--)
+            vn[i] = (v[i] << s) | ((uint64_t) v[i - 1] >> (32 - s));
+        vn[0] = v[0] << s;
+        un[m] = (uint64_t) u[m - 1] >> (32 - s);
+        for (int i = m - 1; i > 0; i--)
+            un[i] = (u[i] << s) | ((uint64_t) u[i - 1] >> (32 - s));
+        un[0] = u[0] << s;
+
+        for (int j = m - n; j >= 0; j--)
+        {
+            uint64_t num = ((uint64_t) un[j + n] << 32) | un[j + n - 1];
+            uint64_t qhat = num / vn[n - 1];
+            uint64_t rhat = num % vn[n - 1];
+            while (qhat >> 32 || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2]))
+            {
+                qhat -= 1;
+                rhat += vn[n - 1];
+                if (rhat >> 32)
+                    break;
+            }
+
+            //un[j..j+n] -= qhat * vn
+            int64_t k = 0, t;
+            for (int i = 0; i < n; i++)
+            {
+                uint64_t p = qhat * vn[i];
+                t = (int64_t) un[i + j] - k - (int64_t) (p & 0xffffffff);
+                un[i + j] = t;
+                k = (int64_t) (p >> 32) - (t >> 32);
+            }
+            t = (int64_t) un[j + n] - k;
+            un[j + n] = t;
+
+            q[j] = qhat;
+            if (t < 0)
+            {
+                //qhat was one too large: add vn back.
+                q[j] -= 1;
+                uint64_t carry = 0;
+                for (int i = 0; i < n; i++)
+                {
+                    uint64_t sum = (uint64_t) un[i + j] + vn[i] + carry;
+                    un[i + j] = sum;
+                    carry = sum >> 32;
+                }
+                un[j + n] += carry;
+            }
+        }
+
+        for (int i = 0; i < n; i++)
+            r[i] = (un[i] >> s) | ((uint64_t) un[i + 1] << (32 - s));
+    }
+
+    //(u_high * 2**256 + u) / v and % v; quotient must fit 256 bits, v != 0.
+    static void divmod(bool u_high, const arith_uint256 &u, const arith_uint256 &v, arith_uint256 &q, arith_uint256 &r)
+    {
+        uint32_t ud[9], vd[8], qd[9] = {}, rd[8] = {};
+        auto u_bytes = ArithToUint256(u);
+        auto v_bytes = ArithToUint256(v);
+        for (int i = 0; i < 8; i++)
+        {
+            ud[i] = ReadLE32(u_bytes.begin() + 4 * i);
+            vd[i] = ReadLE32(v_bytes.begin() + 4 * i);
+        }
+        ud[8] = u_high;
+
+        int m = 9, n = 8;
+        while (m > 1 && ud[m - 1] == 0)
+            m--;
+        while (n > 1 && vd[n - 1] == 0)
+            n--;
+
+        if (m < n)
+        {
+            q = 0;
+            r = u;
+            return;
+        }
+        divmod_digits(ud, m, vd, n, qd, rd);
+
+        uint256 q_bytes, r_bytes;
+        for (int i = 0; i < 8; i++)
+        {
+            WriteLE32(q_bytes.begin() + 4 * i, qd[i]);
+            WriteLE32(r_bytes.begin() + 4 * i, rd[i]);
+        }
+        q = UintToArith256(q_bytes);
+        r = UintToArith256(r_bytes);
+    }
+
+    //int(x / d - 1 + 0.5) of p2pool for x = (x_high * 2**256 + x): round(x / d) - 1, not below 0, up to 2**256 - 1.
+    static uint256 div_round_minus_one(bool x_high, const arith_uint256 &x, const arith_uint256 &d)
+    {
+        arith_uint256 q, r;
+        divmod(x_high, x, d, q, r);
+        //2r >= d without overflow of 2r.
+        if (r >= d - r)
+            return ArithToUint256(q);
+        if (q == 0)
+            return uint256();
+        return ArithToUint256(q - 1);
+    }
+
     uint256 target_to_average_attempts(uint256 target)
     {
-        //TODO: return coind::data::python::PyBitcoindData::target_to_average_attempts(target);
+        //2**256 // (target + 1)
+        auto _target = UintToArith256(target);
+        if (_target == 0)
+            return ArithToUint256(~arith_uint256()); //2**256 doesn't fit
+        if (_target == ~arith_uint256())
+            return ArithToUint256(arith_uint256(1));
+
+        //shares of the chain repeat the same few targets.
+        struct memo_entry
+        {
+            uint256 target;
+            uint256 attempts;
+        };
+        thread_local std::array<memo_entry, 64> memo{};
+        auto key = target.GetUint64(0) ^ target.GetUint64(1) ^ target.GetUint64(2) ^ target.GetUint64(3);
+        auto &entry = memo[(key * 0x9e3779b97f4a7c15ull) >> 58];
+        if (entry.target == target)
+            return entry.attempts;
+
+        arith_uint256 q, r;
+        divmod(true, arith_uint256(), _target + 1, q, r);
+        entry.target = target;
+        entry.attempts = ArithToUint256(q);
+        return entry.attempts;
     }
 
     uint256 average_attempts_to_target(uint256 average_attempts)
     {
-        //TODO: return coind::data::python::PyBitcoindData::average_attempts_to_target(average_attempts);
+        //min(int(2**256 / average_attempts - 1 + 0.5), 2**256 - 1)
+        auto _average_attempts = UintToArith256(average_attempts);
+        if (_average_attempts == 0)
+            throw std::invalid_argument("average_attempts_to_target: average_attempts == 0");
+        if (_average_attempts == 1)
+            return ArithToUint256(~arith_uint256());
+        return div_round_minus_one(true, arith_uint256(), _average_attempts);
     }
 
+    //0xffff0000 * 2**(256-64) + 1: target of difficulty 1.
+    static const arith_uint256 difficulty_1_target = (arith_uint256(0xffff0000) << 192) + 1;
+
     double target_to_difficulty(uint256 target)
     {
-        //TODO: return coind::data::python::PyBitcoindData::target_to_difficulty(target);
+        return difficulty_1_target.getdouble() / (UintToArith256(target).getdouble() + 1.0);
     }
 
     uint256 difficulty_to_target(uint256 difficulty)
     {
-        //TODO: return coind::data::python::PyBitcoindData::difficulty_to_target(difficulty);
+        //min(int((0xffff0000 * 2**(256-64) + 1) / difficulty - 1 + 0.5), 2**256 - 1)
+        auto _difficulty = UintToArith256(difficulty);
+        if (_difficulty == 0)
+            return ArithToUint256(~arith_uint256());
+        return div_round_minus_one(false, difficulty_1_target, _difficulty);
     }
 
-    uint256 hash256(std::string data)
+    //SIMD SHA256 backends (SSE4.1/AVX2/SHA-NI) for CSHA256 and SHA256D64, selected once.
+    static void init_sha256()
     {
-        uint256 result;
-
-        vector<unsigned char> out1;
-        out1.resize(CSHA256::OUTPUT_SIZE);
-
-        vector<unsigned char> out2;
-        out2.resize(CSHA256::OUTPUT_SIZE);
-
-        CSHA256().Write((unsigned char *)&data[0], data.length()).Finalize(&out1[0]);
-        CSHA256().Write((unsigned char *)&out1[0], out1.size()).Finalize(&out2[0]);
+        static const std::string sha256_impl = SHA256AutoDetect();
+    }
 
-        auto _hash = HexStr(out2);
-        result.SetHex(_hash);
-//        std::reverse(result.begin(), result.end());
+    //uint256 vector is used as contiguous array of 32-byte hashes.
+    static_assert(sizeof(uint256) == uint256::WIDTH);
 
+    uint256 hash256(Span<const unsigned char> data)
+    {
+        init_sha256();
+        uint256 result;
+        unsigned char out1[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(data.data(), data.size()).Finalize(out1);
+        CSHA256().Write(out1, CSHA256::OUTPUT_SIZE).Finalize(result.begin());
         return result;
     }
 
-    uint256 hash256(PackStream stream)
+    uint256 hash256(const std::string &data)
     {
-        auto _bytes = stream.bytes();
-        string in(reinterpret_cast<char const *>(_bytes), stream.size());
-        return hash256(in);
+        return hash256(Span<const unsigned char>((const unsigned char *) data.data(), data.size()));
     }
 
-    uint256 hash256(uint256 data)
+    uint256 hash256(const PackStream &stream)
     {
-        string in = data.GetHex();
-        return hash256(in);
+        return hash256(Span<const unsigned char>(stream.data.data() + stream.cursor, stream.size()));
     }
 
-    uint160 hash160(string data)
+    uint256 hash256(const uint256 &data)
     {
-        uint160 result;
+        return hash256(Span<const unsigned char>(data.begin(), uint256::WIDTH));
+    }
 
-        vector<unsigned char> out1;
-        out1.resize(CSHA256::OUTPUT_SIZE);
+    uint160 hash160(Span<const unsigned char> data)
+    {
+        init_sha256();
+        uint160 result;
+        unsigned char out1[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(data.data(), data.size()).Finalize(out1);
+        CRIPEMD160().Write(out1, CSHA256::OUTPUT_SIZE).Finalize(result.begin());
+        return result;
+    }
 
-        vector<unsigned char> out2;
-        out2.resize(CRIPEMD160::OUTPUT_SIZE);
+    uint160 hash160(const string &data)
+    {
+        return hash160(Span<const unsigned char>((const unsigned char *) data.data(), data.size()));
+    }
 
-        CSHA256().Write((unsigned char *)&data[0], data.length()).Finalize(&out1[0]);
-        CRIPEMD160().Write((unsigned char *)&out1[0], out1.size()).Finalize(&out2[0]);
-        result.SetHex(HexStr(out2));
+    uint160 hash160(const PackStream &stream)
+    {
+        return hash160(Span<const unsigned char>(stream.data.data() + stream.cursor, stream.size()));
+    }
 
-        return result;
+    uint160 hash160(const uint160 &data)
+    {
+        return hash160(Span<const unsigned char>(data.begin(), uint160::WIDTH));
     }
 
-    uint160 hash160(PackStream stream)
+    uint256 HeaderHasher::operator()(Span<const unsigned char> header)
     {
-        auto _bytes = stream.bytes();
-        string in(reinterpret_cast<char const *>(_bytes), stream.size());
-        return hash160(in);
+        if (header.size() != header_size)
+            throw std::invalid_argument("HeaderHasher: header size != 80");
+
+        if (!has_midstate || std::memcmp(prefix, header.data(), prefix_size) != 0)
+        {
+            init_sha256();
+            std::memcpy(prefix, header.data(), prefix_size);
+            midstate.Reset().Write(prefix, prefix_size);
+            has_midstate = true;
+        }
+
+        uint256 result;
+        unsigned char out1[CSHA256::OUTPUT_SIZE];
+        CSHA256(midstate).Write(header.data() + prefix_size, header_size - prefix_size).Finalize(out1);
+        CSHA256().Write(out1, CSHA256::OUTPUT_SIZE).Finalize(result.begin());
+        return result;
     }
 
-    uint160 hash160(uint160 data)
+    uint256 HeaderHasher::operator()(const PackStream &packed_header)
     {
-        string in = data.GetHex();
-        return hash160(in);
+        return (*this)(Span<const unsigned char>(packed_header.data.data() + packed_header.cursor, packed_header.size()));
     }
 
     uint256 check_merkle_link(uint256 tip_hash, tuple<vector<uint256>, int32_t> link)
@@ -121,30 +303,68 @@ namespace coind::data
             throw std::invalid_argument("index too large");
         }
 
+        init_sha256();
         auto cur = tip_hash;
 
-        int i = 0;
-        for (auto h : branch)
+        //packed MerkleRecordType: left + right.
+        unsigned char merkle_rec[2 * uint256::WIDTH];
+        for (size_t i = 0; i < branch.size(); i++)
         {
-            if ((index >> i) & 1)
-            {
-                auto merkle_rec = MerkleRecordType{h, cur};
-                PackStream ps;
-                ps << merkle_rec;
-                cur = hash256(ps);
-            }
-            else
-            {
-                auto merkle_rec = MerkleRecordType{cur, h};
-                PackStream ps;
-                ps << merkle_rec;
-                cur = hash256(ps);
-            }
+            auto &left = ((index >> i) & 1) ? branch[i] : cur;
+            auto &right = ((index >> i) & 1) ? cur : branch[i];
+            std::copy(left.begin(), left.end(), merkle_rec);
+            std::copy(right.begin(), right.end(), merkle_rec + uint256::WIDTH);
+            SHA256D64(cur.begin(), merkle_rec, 1);
         }
 
         return cur;
     }
 
+    //pairs of level -> next level, in place: level[i] = hash256(level[2i] + level[2i+1]); odd last hash paired with itself.
+    static void merkle_level(vector<uint256> &level)
+    {
+        if (level.size() & 1)
+            level.push_back(level.back());
+        auto pairs = level.size() / 2;
+        //input block i (64 bytes) is read before output i (32 bytes) overwrites it.
+        SHA256D64(level[0].begin(), level[0].begin(), pairs);
+        level.resize(pairs);
+    }
+
+    uint256 merkle_hash(const vector<uint256> &hashes)
+    {
+        if (hashes.empty())
+            return uint256();
+
+        init_sha256();
+        vector<uint256> level(hashes);
+        while (level.size() > 1)
+        {
+            merkle_level(level);
+        }
+        return level[0];
+    }
+
+    tuple<vector<uint256>, int32_t> calculate_merkle_link(const vector<uint256> &hashes, int32_t index)
+    {
+        if (index < 0 || (size_t) index >= hashes.size())
+            throw std::invalid_argument("calculate_merkle_link: index out of range");
+
+        init_sha256();
+        vector<uint256> branch;
+        vector<uint256> level(hashes);
+        size_t pos = index;
+        //nodes on the path of index are garbage, when hashes[index] is; only siblings are taken.
+        while (level.size() > 1)
+        {
+            auto sibling = pos ^ 1;
+            branch.push_back(sibling < level.size() ? level[sibling] : level[pos]);
+            merkle_level(level);
+            pos >>= 1;
+        }
+        return std::make_tuple(branch, index);
+    }
+
     PackStream pubkey_hash_to_script2(uint160 pubkey_hash)
     {
         auto packed_pubkey_hash = IntType(160)(pubkey_hash);
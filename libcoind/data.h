@@ -44,18 +44,45 @@ namespace coind::data
 
 namespace coind::data
 {
-    //TODO: want 4 optimization???
-    uint256 hash256(std::string data);
+    //sha256d of raw bytes, digest written straight into result (p2pool IntType(256).unpack(digest)).
+    uint256 hash256(Span<const unsigned char> data);
 
-    uint256 hash256(PackStream stream);
+    uint256 hash256(const std::string &data);
 
-    uint256 hash256(uint256 data);
+    //unread bytes of stream.
+    uint256 hash256(const PackStream &stream);
 
-    uint160 hash160(string data);
+    uint256 hash256(const uint256 &data);
 
-    uint160 hash160(PackStream stream);
+    //ripemd160(sha256) of raw bytes.
+    uint160 hash160(Span<const unsigned char> data);
 
-    uint160 hash160(uint160 data);
+    uint160 hash160(const string &data);
+
+    uint160 hash160(const PackStream &stream);
+
+    uint160 hash160(const uint160 &data);
+
+    //hash256 of packed 80-byte block headers. SHA256 state after the first 64 bytes (version, previous_block, merkle_root[0:28])
+    //is kept, so headers of one job, that differ in timestamp/nonce, process only the last 16 bytes.
+    //One hasher per connection/job: not thread-safe.
+    class HeaderHasher
+    {
+    public:
+        static const size_t header_size = 80;
+        static const size_t prefix_size = 64;
+
+    private:
+        unsigned char prefix[prefix_size];
+        CSHA256 midstate;
+        bool has_midstate = false;
+
+    public:
+        uint256 operator()(Span<const unsigned char> header);
+
+        //unread bytes of packed_header.
+        uint256 operator()(const PackStream &packed_header);
+    };
 
     struct MerkleRecordType
     {
@@ -78,6 +105,13 @@ namespace coind::data
     //link = MerkleLink from shareTypes.h
     uint256 check_merkle_link(uint256 tip_hash, tuple<vector<uint256>, int32_t> link);
 
+    //p2pool merkle_hash: root of hashes, 0 for empty list.
+    //Every tree level hashed in one SHA256D64 call (SSE4.1/AVX2/SHA-NI, when CPU has them).
+    uint256 merkle_hash(const vector<uint256> &hashes);
+
+    //p2pool calculate_merkle_link: branch for hashes[index]; hashes[index] itself isn't used (None for gentx).
+    tuple<vector<uint256>, int32_t> calculate_merkle_link(const vector<uint256> &hashes, int32_t index);
+
     struct HumanAddressType
     {
         IntType(8) version;
@@ -22,6 +22,8 @@ UniValue coind::JSONRPC_Coind::_request(const char *method_name, std::shared_ptr
 
 	char* request_body = new char[strlen(req_format) + strlen(method_name) + params_len + 1];
 	sprintf(request_body, req_format, method_name, params);
+
+	std::lock_guard<std::mutex> lock(request_mutex);
 	req.body() = request_body;
 	req.prepare_payload();
 
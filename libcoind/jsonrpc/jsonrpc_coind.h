@@ -4,6 +4,7 @@
 #include <univalue.h>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
+#include <mutex>
 namespace io = boost::asio;
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -34,6 +35,9 @@ namespace coind
 		char *authorization;
 		char *host;
 
+		//one connection: requests from node thread and compute pool (block heights) are serialized.
+		std::mutex request_mutex;
+
 	private:
 		//TODO: template request params
 		UniValue _request(const char *method_name, std::shared_ptr<coind::jsonrpc::data::TemplateRequest> req_param = nullptr);
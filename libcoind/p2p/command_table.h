@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdexcept>
+
+#include <btclibs/crypto/common.h>
+
+namespace coind::p2p
+{
+    //Command of p2p message header: 12 bytes, zero padded; compared as two integers instead of string.
+    struct CommandKey
+    {
+        static constexpr size_t size = 12;
+
+        uint64_t low = 0;
+        uint32_t high = 0;
+
+        constexpr bool operator==(const CommandKey &other) const { return low == other.low && high == other.high; }
+
+        constexpr bool operator!=(const CommandKey &other) const { return !(*this == other); }
+
+        //"ping" -> 'p','i','n','g',0,0,0,0,0,0,0,0
+        static constexpr CommandKey from_name(const char *name)
+        {
+            CommandKey key;
+            for (size_t i = 0; i < size && name[i]; i++)
+            {
+                if (i < 8)
+                    key.low |= uint64_t((unsigned char) name[i]) << (8 * i);
+                else
+                    key.high |= uint32_t((unsigned char) name[i]) << (8 * (i - 8));
+            }
+            return key;
+        }
+
+        //12 bytes of received message header; like p2pool, padding must be zeros.
+        static CommandKey from_bytes(const char *bytes)
+        {
+            auto data = (const unsigned char *) bytes;
+            return {ReadLE64(data), ReadLE32(data + 8)};
+        }
+
+        void write(unsigned char *bytes) const
+        {
+            WriteLE64(bytes, low);
+            WriteLE32(bytes + 8, high);
+        }
+    };
+
+    //Compile-time command table of protocol: command bytes -> enum by perfect hash, enum -> command bytes by index.
+    //Entry i should be command with enum value i: enum -> bytes is one index; others (cmd_error = 9999) are found by scan.
+    template <typename ENUM_T, size_t N>
+    class CommandTable
+    {
+    public:
+        struct Entry
+        {
+            ENUM_T cmd;
+            const char *name;
+        };
+
+    private:
+        //>= 4 slots per command: perfect hash seed is found after few tries.
+        static constexpr int bits = [] {
+            int result = 1;
+            while ((size_t(1) << result) < 4 * N)
+                result++;
+            return result;
+        }();
+        static constexpr size_t slots = size_t(1) << bits;
+
+        struct Slot
+        {
+            CommandKey key;
+            int entry = -1;
+        };
+
+        std::array<Entry, N> entries;
+        std::array<CommandKey, N> keys{};
+        std::array<Slot, slots> table{};
+        uint64_t seed = 0;
+
+        static constexpr size_t index(const CommandKey &key, uint64_t multiplier)
+        {
+            return ((key.low + key.high * 0x9E3779B97F4A7C15ull) * multiplier) >> (64 - bits);
+        }
+
+    public:
+        constexpr CommandTable(const std::array<Entry, N> &_entries) : entries(_entries)
+        {
+            for (size_t i = 0; i < N; i++)
+                keys[i] = CommandKey::from_name(entries[i].name);
+
+            //search multiplier without collisions; duplicate commands never pass -> compile error.
+            for (uint64_t attempt = 1; attempt < 100000; attempt++)
+            {
+                seed = (attempt * 0xBF58476D1CE4E5B9ull) | 1;
+                table = {};
+                bool collision = false;
+                for (size_t i = 0; i < N && !collision; i++)
+                {
+                    auto &slot = table[index(keys[i], seed)];
+                    collision = slot.entry != -1;
+                    slot.key = keys[i];
+                    slot.entry = i;
+                }
+                if (!collision)
+                    return;
+            }
+            throw std::logic_error("CommandTable: perfect hash not found");
+        }
+
+        //nullptr, if command unknown.
+        constexpr const Entry *find(const CommandKey &key) const
+        {
+            const auto &slot = table[index(key, seed)];
+            return (slot.entry != -1 && slot.key == key) ? &entries[slot.entry] : nullptr;
+        }
+
+        //nullptr, if cmd not in table.
+        constexpr const CommandKey *key(ENUM_T cmd) const
+        {
+            auto i = size_t(cmd);
+            if (i < N && entries[i].cmd == cmd)
+                return &keys[i];
+            for (size_t j = 0; j < N; j++)
+            {
+                if (entries[j].cmd == cmd)
+                    return &keys[j];
+            }
+            return nullptr;
+        }
+
+        //nullptr, if cmd not in table.
+        constexpr const char *name(ENUM_T cmd) const
+        {
+            auto k = key(cmd);
+            return k ? entries[k - keys.data()].name : nullptr;
+        }
+
+        //every command with value < N is entry with that index: enum -> bytes without scan.
+        constexpr bool indexed() const
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                auto cmd = size_t(entries[i].cmd);
+                if (cmd < N && cmd != i)
+                    return false;
+            }
+            return true;
+        }
+    };
+}
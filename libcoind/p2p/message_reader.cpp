@@ -0,0 +1,115 @@
+#include "message_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <btclibs/crypto/common.h>
+#include <libdevcore/logger.h>
+#include <libcoind/data.h>
+
+namespace coind::p2p
+{
+    MessageReader::MessageReader(const unsigned char *_prefix, size_t prefix_len, size_t _capacity) : prefix(_prefix, _prefix + prefix_len), buf(_capacity), capacity(_capacity)
+    {
+    }
+
+    Span<unsigned char> MessageReader::prepare()
+    {
+        if (begin == end)
+        {
+            begin = end = 0;
+            //buffer was grown for big message (block): return memory.
+            if (buf.size() > capacity)
+            {
+                buf.resize(capacity);
+                buf.shrink_to_fit();
+            }
+        }
+
+        auto msg_size = next_message_size();
+        auto need = std::max(min_read_size, msg_size > size() ? msg_size - size() : 0);
+        if (buf.size() - end < need)
+        {
+            if (begin > 0)
+            {
+                std::memmove(buf.data(), buf.data() + begin, size());
+                end -= begin;
+                begin = 0;
+            }
+            if (buf.size() - end < need)
+                buf.resize(end + need);
+        }
+        return Span<unsigned char>(buf.data() + end, buf.size() - end);
+    }
+
+    void MessageReader::commit(size_t n)
+    {
+        end = std::min(end + n, buf.size());
+    }
+
+    size_t MessageReader::frame(const handler_type &handler)
+    {
+        size_t count = 0;
+        while (sync_prefix() && size() >= header_len())
+        {
+            auto header = buf.data() + begin + prefix.size();
+            auto command = (const char *) header;
+            auto length = ReadLE32(header + command_len);
+            auto checksum = header + command_len + length_len;
+            auto payload = checksum + checksum_len;
+
+            if (length > max_payload_length)
+            {
+                LOG_WARNING << "MessageReader: length too large for " << std::string(command, strnlen(command, command_len)) << ": " << length;
+                begin += prefix.size();
+                continue;
+            }
+            if (size() < header_len() + length)
+                break;
+            begin += header_len() + length;
+
+            auto payload_hash = coind::data::hash256(Span<const unsigned char>(payload, length));
+            if (std::memcmp(payload_hash.begin(), checksum, checksum_len) != 0)
+            {
+                LOG_WARNING << "MessageReader: invalid checksum for " << std::string(command, strnlen(command, command_len));
+                continue;
+            }
+
+            handler(command, Span<const unsigned char>(payload, length));
+            count++;
+        }
+        return count;
+    }
+
+    bool MessageReader::sync_prefix()
+    {
+        auto first = buf.data() + begin;
+        auto last = buf.data() + end;
+        auto found = std::search(first, last, prefix.begin(), prefix.end());
+        if (found == last)
+        {
+            //tail of buffer can be start of prefix.
+            auto keep = std::min(size(), prefix.size() - 1);
+            if (size() > keep)
+                LOG_WARNING << "MessageReader: skipped " << size() - keep << " bytes without prefix";
+            begin = end - keep;
+            return false;
+        }
+
+        if (found != first)
+            LOG_WARNING << "MessageReader: skipped " << found - first << " bytes before prefix";
+        begin = found - buf.data();
+        return true;
+    }
+
+    size_t MessageReader::next_message_size() const
+    {
+        if (size() < header_len() || !std::equal(prefix.begin(), prefix.end(), buf.begin() + begin))
+            return header_len();
+        auto length = ReadLE32(buf.data() + begin + prefix.size() + command_len);
+        if (length > max_payload_length)
+            return header_len();
+        return header_len() + length;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+#include <btclibs/span.h>
+
+namespace coind::p2p
+{
+    //Receive buffer of p2p connection: prefix + command[12] + length[4] + checksum[4] + payload.
+    //Socket reads as much as available into prepare(), then frame() dispatches all complete messages at once.
+    class MessageReader
+    {
+    public:
+        static constexpr size_t command_len = 12;
+        static constexpr size_t length_len = 4;
+        static constexpr size_t checksum_len = 4;
+        static constexpr uint32_t max_payload_length = 8000000;
+        //free space, that is requested from socket by one read.
+        static constexpr size_t min_read_size = 4096;
+
+        typedef std::function<void(const char *command, Span<const unsigned char> payload)> handler_type;
+
+    public:
+        MessageReader(const unsigned char *prefix, size_t prefix_len, size_t capacity = 64 * 1024);
+
+        //Free tail of buffer for next read; large enough for rest of current message.
+        Span<unsigned char> prepare();
+
+        //n bytes were read into prepare() buffer.
+        void commit(size_t n);
+
+        //Call handler for every complete message in buffer; returns number of dispatched messages.
+        //Like p2pool: garbage before prefix is skipped, messages with too big length or wrong checksum are dropped.
+        size_t frame(const handler_type &handler);
+
+        //unframed bytes in buffer
+        size_t size() const { return end - begin; }
+
+    private:
+        //Skip bytes before prefix; false, if prefix not found in buffer.
+        bool sync_prefix();
+
+        //size of first message in buffer with header, or header size, while length unknown.
+        size_t next_message_size() const;
+
+        size_t header_len() const { return prefix.size() + command_len + length_len + checksum_len; }
+
+    private:
+        std::vector<unsigned char> prefix;
+        std::vector<unsigned char> buf;
+        size_t capacity;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+}
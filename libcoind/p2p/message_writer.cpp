@@ -0,0 +1,68 @@
+#include "message_writer.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <btclibs/crypto/common.h>
+#include <libcoind/data.h>
+
+namespace coind::p2p
+{
+    std::shared_ptr<const PackedMessage> PackedMessage::pack(const CommandKey &command, PackStream payload)
+    {
+        auto msg = std::make_shared<PackedMessage>();
+        command.write(msg->header.data());
+        WriteLE32(msg->header.data() + command_len, payload.data.size());
+        //checksum: first 4 bytes of sha256d(payload).
+        auto payload_hash = coind::data::hash256(Span<const unsigned char>(payload.data.data(), payload.data.size()));
+        std::copy(payload_hash.begin(), payload_hash.begin() + 4, msg->header.begin() + command_len + 4);
+        msg->payload = std::move(payload);
+        return msg;
+    }
+
+    MessageWriter::MessageWriter(const unsigned char *_prefix, size_t prefix_len) : prefix(_prefix, _prefix + prefix_len)
+    {
+    }
+
+    void MessageWriter::push(std::shared_ptr<const PackedMessage> msg)
+    {
+        pending.push_back(std::move(msg));
+    }
+
+    const std::vector<boost::asio::const_buffer> &MessageWriter::next_batch()
+    {
+        //buffers of batch in flight are in use by async_write.
+        static const std::vector<boost::asio::const_buffer> nothing;
+        if (writing() || pending.empty())
+            return nothing;
+        buffers.clear();
+
+        auto n = std::min(pending.size(), max_batch_size);
+        in_flight.reserve(n);
+        std::move(pending.begin(), pending.begin() + n, std::back_inserter(in_flight));
+        pending.erase(pending.begin(), pending.begin() + n);
+
+        //in_flight isn't changed until complete(): buffers stay valid.
+        buffers.reserve(n * 3);
+        for (auto &msg : in_flight)
+        {
+            buffers.emplace_back(prefix.data(), prefix.size());
+            buffers.emplace_back(msg->header.data(), msg->header.size());
+            if (!msg->payload.data.empty())
+                buffers.emplace_back(msg->payload.data.data(), msg->payload.data.size());
+        }
+        return buffers;
+    }
+
+    void MessageWriter::complete()
+    {
+        in_flight.clear();
+        buffers.clear();
+    }
+
+    void MessageWriter::clear()
+    {
+        pending.clear();
+        complete();
+    }
+}
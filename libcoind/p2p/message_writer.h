@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <libdevcore/stream.h>
+#include "command_table.h"
+
+namespace coind::p2p
+{
+    //Frame of p2p message without prefix: command + length + checksum, payload.
+    //Immutable after pack(), so one frame can be queued to many connections (broadcast).
+    struct PackedMessage
+    {
+        static constexpr size_t command_len = 12;
+        static constexpr size_t header_len = 12 + 4 + 4;
+
+        std::array<unsigned char, header_len> header;
+        PackStream payload;
+
+        static std::shared_ptr<const PackedMessage> pack(const CommandKey &command, PackStream payload);
+
+        static std::shared_ptr<const PackedMessage> pack(const char *command, PackStream payload) { return pack(CommandKey::from_name(command), std::move(payload)); }
+    };
+
+    //Outbound queue of p2p connection. Holds packed messages until they are written;
+    //pending messages are coalesced into one gather write: prefix, header and payload of every message.
+    //Socket keeps exactly one write outstanding: next_batch() -> async_write -> complete() -> next_batch()...
+    class MessageWriter
+    {
+    public:
+        //messages in one async_write.
+        static constexpr size_t max_batch_size = 128;
+
+    public:
+        MessageWriter(const unsigned char *prefix, size_t prefix_len);
+
+        void push(std::shared_ptr<const PackedMessage> msg);
+
+        void push(const CommandKey &command, PackStream payload) { push(PackedMessage::pack(command, std::move(payload))); }
+
+        void push(const char *command, PackStream payload) { push(PackedMessage::pack(command, std::move(payload))); }
+
+        //Move pending messages in flight; buffers for async_write, empty if nothing to write.
+        const std::vector<boost::asio::const_buffer> &next_batch();
+
+        //Batch in flight was written.
+        void complete();
+
+        //Drop all messages (connection failed).
+        void clear();
+
+        bool writing() const { return !in_flight.empty(); }
+
+        size_t pending_size() const { return pending.size(); }
+
+    private:
+        std::vector<unsigned char> prefix;
+        std::deque<std::shared_ptr<const PackedMessage>> pending;
+        std::vector<std::shared_ptr<const PackedMessage>> in_flight;
+        std::vector<boost::asio::const_buffer> buffers;
+    };
+}
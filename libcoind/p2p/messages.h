@@ -15,8 +15,10 @@ using namespace c2pool::messages;
 #include <memory>
 #include <tuple>
 #include <map>
+#include <cstring>
 
 #include <libdevcore/logger.h>
+#include "command_table.h"
 
 namespace coind::p2p
 {
@@ -46,8 +48,8 @@ namespace coind::p2p::messages
         cmd_headers
     };
 
-    const std::map<commands, const char *> _string_commands = {
-        {cmd_error, "error"},
+    //entry i is command with value i.
+    inline constexpr coind::p2p::CommandTable<commands, 16> command_table({{
         {cmd_version, "version"},
         {cmd_verack, "verack"},
         {cmd_ping, "ping"},
@@ -62,50 +64,42 @@ namespace coind::p2p::messages
         {cmd_getheaders, "getheaders"},
         {cmd_tx, "tx"},
         {cmd_block, "block"},
-        {cmd_headers, "headers"}};
-
-    const std::map<const char *, commands> _reverse_string_commands = {
-        {"error", cmd_error},
-        {"version", cmd_version},
-        {"verack", cmd_verack},
-        {"ping", cmd_ping},
-        {"pong", cmd_pong},
-        {"alert", cmd_alert},
-        {"getaddr", cmd_getaddr},
-        {"addr", cmd_addr},
-        {"inv", cmd_inv},
-        {"getdata", cmd_getdata},
-        {"reject", cmd_reject},
-        {"getblocks", cmd_getblocks},
-        {"getheaders", cmd_getheaders},
-        {"tx", cmd_tx},
-        {"block", cmd_block},
-        {"headers", cmd_headers}};
+        {cmd_headers, "headers"},
+        {cmd_error, "error"}
+    }});
 
     inline const char *string_coind_commands(commands cmd)
     {
-        try
-        {
-            return _string_commands.at(cmd);
-        }
-        catch (const std::out_of_range &e)
+        auto name = command_table.name(cmd);
+        if (!name)
         {
             LOG_WARNING << (int)cmd << " out of range in string_coind_commands";
             return "error";
         }
+        return name;
     }
 
     inline commands reverse_string_commands(const char *key)
     {
-        try
+        auto entry = command_table.find(coind::p2p::CommandKey::from_name(key));
+        if (!entry)
         {
-            return _reverse_string_commands.at(key);
+            LOG_WARNING << key << " out of range in reverse_string_commands";
+            return commands::cmd_error;
         }
-        catch (const std::out_of_range &e)
+        return entry->cmd;
+    }
+
+    //command from 12 bytes of received message header.
+    inline commands reverse_header_command(const char *command)
+    {
+        auto entry = command_table.find(coind::p2p::CommandKey::from_bytes(command));
+        if (!entry)
         {
-            LOG_WARNING << key << " out of range in reverse_string_commands";
+            LOG_WARNING << std::string(command, strnlen(command, coind::p2p::CommandKey::size)) << " out of range in reverse_header_command";
             return commands::cmd_error;
         }
+        return entry->cmd;
     }
 
     //base_message type for handle
@@ -118,20 +112,20 @@ namespace coind::p2p::messages
         PackStream value;
 
     public:
-        raw_message()
+        raw_message(commands cmd) : name_type(cmd)
         {
         }
 
         PackStream &write(PackStream &stream)
         {
-            stream << name_type << value;
+            stream << value;
             return stream;
         }
 
         PackStream &read(PackStream &stream)
         {
-            stream >> name_type;
-            value = PackStream(stream);
+            //command is from message header, stream is payload: take buffer without copy.
+            value = std::move(stream);
             return stream;
         }
     };
@@ -201,8 +195,8 @@ namespace coind::p2p::messages
         IntType(32) version;
         IntType(64) services;
         IntType(64) timestamp;
-        address_type addr_to;
-        address_type addr_from;
+        c2pool::messages::stream::address_type_stream addr_to;
+        c2pool::messages::stream::address_type_stream addr_from;
         IntType(64) nonce;
         StrType sub_version;
         IntType(32) start_height;
@@ -345,14 +339,14 @@ namespace coind::p2p::messages
     class message_addr : public base_message
     {
     public:
-        ListType<c2pool::messages::addr> addrs;
+        ListType<c2pool::messages::stream::addr_stream> addrs;
 
     public:
         message_addr() : base_message("addr") {}
 
         message_addr(std::vector<c2pool::messages::addr> _addrs) : base_message("addr")
         {
-            addrs = _addrs;
+            addrs = c2pool::messages::stream::addr_stream::make_list_type(_addrs);
         }
 
         PackStream &write(PackStream &stream) override
@@ -55,7 +55,7 @@ namespace coind::p2p
         void get_block_header(uint256 hash);
 
     public:
-        shared_ptr<raw_message> make_raw_message() { return make_shared<raw_message>(); }
+        shared_ptr<raw_message> make_raw_message(commands cmd) { return make_shared<raw_message>(cmd); }
 
         void handle(shared_ptr<raw_message> RawMSG)
         {
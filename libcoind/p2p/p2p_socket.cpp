@@ -24,7 +24,7 @@ using namespace coind::p2p::messages;
 
 namespace coind::p2p
 {
-    P2PSocket::P2PSocket(ip::tcp::socket socket, std::shared_ptr<coind::ParentNetwork> __parent_net) : _socket(std::move(socket)), _parent_net(__parent_net)
+    P2PSocket::P2PSocket(ip::tcp::socket socket, std::shared_ptr<coind::ParentNetwork> __parent_net) : _socket(std::move(socket)), _parent_net(__parent_net), _reader(__parent_net->PREFIX, __parent_net->PREFIX_LENGTH), _writer(__parent_net->PREFIX, __parent_net->PREFIX_LENGTH)
     {
     }
 
@@ -94,225 +94,75 @@ namespace coind::p2p
 
     void P2PSocket::write(std::shared_ptr<base_message> msg)
     {
-        write_prefix(msg);
-    }
-
-    void P2PSocket::write_prefix(std::shared_ptr<base_message> msg)
-    {
-        boost::asio::async_write(_socket, boost::asio::buffer(_parent_net->PREFIX, _parent_net->PREFIX_LENGTH),
-                                 [this, msg](boost::system::error_code _ec, std::size_t length)
-                                 {
-                                     if (_ec)
-                                     {
-                                         LOG_ERROR << "P2PSocket::write_prefix()" << _ec << ":" << _ec.message();
-                                         return;
-                                     }
-                                     write_message_data(msg);
-                                 });
-    }
-
-    struct SendPackedMsg
-    {
-        char *data;
-        int32_t len;
-
-        SendPackedMsg(std::shared_ptr<base_message> msg)
+        //payload serialized once; queue owns it until write completes.
+        PackStream payload;
+        payload << *msg;
+        //12 command bytes from compile-time table.
+        auto command = command_table.key(msg->cmd);
+        if (!command)
         {
-            PackStream value;
-
-            //command [+]
-            const char *temp_cmd = coind::p2p::messages::string_coind_commands(msg->cmd);
-            auto command = new char[12]{'\0'};
-            memcpy(command, temp_cmd, strlen(temp_cmd));
-            PackStream s_command(command, 12);
-            value << s_command;
-            delete command;
-
-            //-----
-            PackStream payload_stream;
-            payload_stream << *msg;
-
-            //len [+]
-            IntType(32) unpacked_len(payload_stream.size());
-            value << unpacked_len;
-
-            //checksum [-]
-            PackStream payload_checksum_stream;
-            payload_checksum_stream << *msg;
-
-            auto __checksum = coind::data::hash256(payload_checksum_stream);
-            IntType(256) checksum_full(__checksum);
-            PackStream _packed_checksum;
-            _packed_checksum << checksum_full;
-            //TODO: почему результат реверснутый?
-            vector<unsigned char> packed_checksum(_packed_checksum.data.end()-4, _packed_checksum.data.end());
-            std::reverse(packed_checksum.begin(), packed_checksum.end());
-            PackStream checksum(packed_checksum);
-            value << checksum;
-
-            //payload [+]
-            value << payload_stream;
-
-            //result
-            data = new char[value.size()];
-            memcpy(data, value.bytes(), value.size());
-            len = value.size();
+            LOG_WARNING << (int)msg->cmd << " out of range in command_table";
+            command = command_table.key(cmd_error);
         }
+        _writer.push(*command, std::move(payload));
 
-        ~SendPackedMsg()
-        {
-            if (data != nullptr)
-            {
-                delete data;
-            }
-        }
-    };
+        //one write outstanding: queued messages are sent after it.
+        if (!_writer.writing())
+            start_write();
+    }
 
-    void P2PSocket::write_message_data(std::shared_ptr<base_message> _msg)
+    void P2PSocket::start_write()
     {
-        SendPackedMsg msg(_msg);
-        boost::asio::async_write(_socket, boost::asio::buffer(msg.data, msg.len),
-                                 //TODO: this -> shared_this()
-                                 [this](boost::system::error_code _ec, std::size_t length)
+        auto &buffers = _writer.next_batch();
+        if (buffers.empty())
+            return;
+
+        boost::asio::async_write(_socket, buffers,
+                                 [self = shared_from_this()](boost::system::error_code _ec, std::size_t length)
                                  {
                                      if (_ec)
                                      {
-                                         LOG_ERROR << "P2PSocket::write_message_data()" << _ec << ":" << _ec.message();
+                                         LOG_ERROR << "P2PSocket::start_write()" << _ec << ":" << _ec.message();
+                                         self->_writer.clear();
+                                         return;
                                      }
+                                     self->_writer.complete();
+                                     self->start_write();
                                  });
     }
 
     void P2PSocket::start_read()
     {
-        LOG_TRACE << "START READING!:";
-        //make raw_message for reading data
-        shared_ptr<ReadPackedMsg> msg = std::make_shared<ReadPackedMsg>(_parent_net->PREFIX_LENGTH);
-        LOG_TRACE << "created temp_raw_message";
-        //Socket started for reading!
-        read_prefix(msg);
-    }
-
-    void P2PSocket::read_prefix(shared_ptr<ReadPackedMsg> msg)
-    {
-        LOG_TRACE << "socket status: " << _socket.is_open();
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->prefix, _parent_net->PREFIX_LENGTH),
-                                [this, msg](boost::system::error_code ec, std::size_t length)
-                                {
-                                    LOG_TRACE << "try to read prefix";
-                                    //TODO: compare
-                                    if (!ec /*&& c2pool::dev::compare_str(tempRawMessage->converter->prefix, _net->PREFIX, tempRawMessage->converter->get_prefix_len())*/)
-                                    {
-                                        // LOG_INFO << "MSG: " << tempMessage->command;
-                                        read_command(msg);
-                                    }
-                                    else
-                                    {
-                                        LOG_TRACE << "socket status when error in prefix: " << _socket.is_open();
-                                        LOG_ERROR << "read_prefix: " << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
-    }
-
-    void P2PSocket::read_command(shared_ptr<ReadPackedMsg> msg)
-    {
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->command, msg->COMMAND_LEN),
-                                [this, msg](boost::system::error_code ec, std::size_t /*length*/)
-                                {
-                                    if (!ec)
-                                    {
-                                        LOG_TRACE << "try to read command";
-                                        read_length(msg);
-                                    }
-                                    else
-                                    {
-                                        LOG_ERROR << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
-    }
-
-    void P2PSocket::read_length(shared_ptr<ReadPackedMsg> msg)
-    {
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->len, msg->LEN_LEN),
-                                [this, msg](boost::system::error_code ec, std::size_t /*length*/)
-                                {
-                                    if (!ec)
-                                    {
-                                        LOG_TRACE << "try to read length";
-                                        read_checksum(msg);
-                                    }
-                                    else
-                                    {
-                                        LOG_ERROR << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
-    }
-
-    void P2PSocket::read_checksum(shared_ptr<ReadPackedMsg> msg)
-    {
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->checksum, msg->CHECKSUM_LEN),
-                                [this, msg](boost::system::error_code ec, std::size_t /*length*/)
+        //read all available bytes, then frame every complete message from buffer.
+        auto free_space = _reader.prepare();
+        _socket.async_read_some(boost::asio::buffer(free_space.data(), free_space.size()),
+                                [this](boost::system::error_code ec, std::size_t length)
                                 {
-                                    if (!ec)
+                                    if (ec)
                                     {
-                                        LOG_TRACE << "try to read checksum";
-                                        // LOG_INFO << "read_checksum";
-                                        read_payload(msg);
-                                    }
-                                    else
-                                    {
-                                        LOG_ERROR << ec << " " << ec.message();
+                                        LOG_ERROR << "P2PSocket::start_read(): " << ec << " " << ec.message();
                                         disconnect();
+                                        return;
                                     }
-                                });
-    }
-    void P2PSocket::read_payload(shared_ptr<ReadPackedMsg> msg)
-    {
-        LOG_TRACE << "read_payload";
-        PackStream stream_len(msg->len, msg->LEN_LEN);
-        IntType(32) payload_len;
-        stream_len >> payload_len;
-        msg->unpacked_len = payload_len.get();
 
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->payload, msg->unpacked_len),
-                                [this, msg](boost::system::error_code ec, std::size_t length)
-                                {
-                                    if (!ec)
-                                    {
-                                        // LOG_INFO << "read_payload";
-                                        LOG_DEBUG << "HANDLE MESSAGE!";
-                                        final_read_message(msg);
+                                    _reader.commit(length);
+                                    _reader.frame([this](const char *command, Span<const unsigned char> payload)
+                                                  {
+                                                      //handler of previous message in batch can disconnect.
+                                                      if (_socket.is_open())
+                                                          final_read_message(command, payload);
+                                                  });
+                                    if (_socket.is_open())
                                         start_read();
-                                    }
-                                    else
-                                    {
-                                        LOG_ERROR << ec << " " << ec.message();
-                                        disconnect();
-                                    }
                                 });
     }
 
-    void P2PSocket::final_read_message(shared_ptr<ReadPackedMsg> msg)
+    void P2PSocket::final_read_message(const char *command, Span<const unsigned char> payload)
     {
-        //checksum check
-        //TODO: !!!
-
-        //Make raw message
-        PackStream stream_RawMsg;
-
-        PackStream stream_command(msg->command, msg->COMMAND_LEN);
-        PackStream stream_payload(msg->payload, msg->unpacked_len);
-
-        stream_RawMsg << stream_command << stream_payload;
+        //Make raw message: command from compile-time table, payload without header.
+        PackStream stream_RawMsg(std::vector<unsigned char>(payload.begin(), payload.end()));
 
-        shared_ptr<raw_message> RawMessage = _protocol.lock()->make_raw_message();
+        shared_ptr<raw_message> RawMessage = _protocol.lock()->make_raw_message(reverse_header_command(command));
         stream_RawMsg >> *RawMessage;
 
         //Protocol handle message
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "messages.h"
+#include "message_reader.h"
+#include "message_writer.h"
 #include <networks/network.h>
 using namespace coind::p2p::messages;
 
@@ -14,41 +16,6 @@ namespace coind::p2p
 #include <boost/function.hpp>
 namespace ip = boost::asio::ip;
 
-namespace coind::p2p
-{
-    struct ReadPackedMsg
-    {
-        const int COMMAND_LEN = 12;
-        const int LEN_LEN = 4;
-        const int CHECKSUM_LEN = 4;
-
-        char *prefix;
-        char *command;
-        char *len;
-        char *checksum;
-        char *payload;
-
-        int32_t unpacked_len;
-
-        ReadPackedMsg(int32_t pref_len)
-        {
-            prefix = new char[pref_len];
-            command = new char[COMMAND_LEN];
-            len = new char[LEN_LEN];
-            checksum = new char[CHECKSUM_LEN];
-        }
-
-        ~ReadPackedMsg()
-        {
-            delete prefix;
-            delete command;
-            delete len;
-            delete checksum;
-            delete payload;
-        }
-    };
-}
-
 namespace coind::p2p
 {
     class P2PSocket : public std::enable_shared_from_this<P2PSocket>
@@ -75,20 +42,16 @@ namespace coind::p2p
 
     private:
         void start_read();
-        void read_prefix(std::shared_ptr<ReadPackedMsg> msg);
-        void read_command(std::shared_ptr<ReadPackedMsg> msg);
-        void read_length(std::shared_ptr<ReadPackedMsg> msg);
-        void read_checksum(std::shared_ptr<ReadPackedMsg> msg);
-        void read_payload(std::shared_ptr<ReadPackedMsg> msg);
-        void final_read_message(std::shared_ptr<ReadPackedMsg> msg);
+        void final_read_message(const char *command, Span<const unsigned char> payload);
 
-        void write_prefix(std::shared_ptr<base_message> msg);
-        void write_message_data(std::shared_ptr<base_message> msg);
+        void start_write();
 
     private:
         ip::tcp::socket _socket;
 
         std::weak_ptr<coind::p2p::CoindProtocol> _protocol;
         std::shared_ptr<coind::ParentNetwork> _parent_net;
+        MessageReader _reader;
+        MessageWriter _writer;
     };
 } // namespace c2pool::p2p
\ No newline at end of file
@@ -8,7 +8,6 @@ namespace coind::data::stream
     {
         if (is_segwit_tx(tx))
         {
-            std::cout << "Segwit tx" << std::endl;
             auto _tx = std::static_pointer_cast<WitnessTransactionType>(tx);
 
             assert(_tx->tx_ins.size() == _tx->witness.size());
@@ -39,11 +38,6 @@ namespace coind::data::stream
         version = _version;
 
         tx_ins = ListType<TxInType_stream>(ListType<TxInType_stream>::make_type(_tx_ins));
-        std::cout << "TXIDType_stream.script: ";
-        for (auto v : tx_ins.l[0].script.value){
-            std::cout << (unsigned int) v << " ";
-        }
-        std::cout << std::endl;
 
         tx_outs = ListType<TxOutType_stream>(ListType<TxOutType_stream>::make_type(_tx_outs));
 
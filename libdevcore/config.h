@@ -34,6 +34,8 @@ namespace c2pool::dev
         int desired_conns = 6; //client max connections
         int max_attempts = 10; //client максимум одновременно обрабатываемых попыток подключения
         //попытка подключения = подключение, которое произошло, но не проверенно на версию и прочие условия.
+        int io_threads = 0;      //threads for p2p sockets; 0 = hardware_concurrency
+        int compute_threads = 0; //threads for share verification (PoW); 0 = hardware_concurrency
     };
 } // namespace c2pool::dev
 
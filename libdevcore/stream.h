@@ -4,6 +4,9 @@
 #include <sstream>
 #include <vector>
 #include <numeric>
+#include <type_traits>
+#include <cstring>
+#include <stdexcept>
 using namespace std;
 
 class PackStream;
@@ -29,6 +32,19 @@ concept StreamIntType = !C_STRING<T> && std::numeric_limits<T>::is_integer;
 template <typename T>
 concept StreamEnumType = std::is_enum_v<T>;
 
+//written/read as raw bytes of object: only for types, which can be copied by memcpy.
+template <typename T>
+concept RawStreamType = std::is_trivially_copyable_v<T> && !StreamObjType<T> && !StreamIntType<T>;
+
+//packed size known at compile time: T::fixed_size bytes, written by write_fixed(out), read by read_fixed(in).
+template <typename T>
+concept FixedSizeType = requires(const T a, T b, unsigned char *out, const unsigned char *in)
+{
+    requires T::fixed_size > 0;
+    a.write_fixed(out);
+    b.read_fixed(in);
+};
+
 struct BaseMaker //TIP, HACK, КОСТЫЛЬ
 {
 };
@@ -106,12 +122,16 @@ struct MakerListType<LIST_TYPE> : BaseMaker
 struct PackStream
 {
     vector<unsigned char> data;
+    //read position in data: operator>> moves it forward instead of erasing the front of data.
+    size_t cursor = 0;
+    //size_only: data not stored, only written size counted (packed_size).
+    bool size_only = false;
+    size_t counted_size = 0;
 
     PackStream() {}
 
-    PackStream(vector<unsigned char> value)
+    PackStream(vector<unsigned char> value) : data(std::move(value))
     {
-        data = value;
     }
 
     PackStream(unsigned char *value, int32_t len)
@@ -125,47 +145,163 @@ struct PackStream
         data = vector<unsigned char>(temp, temp + len);
     }
 
-    PackStream &operator<<(PackStream &val)
+    PackStream(const PackStream &) = default;
+
+    PackStream(PackStream &&other) noexcept : data(std::move(other.data)), cursor(other.cursor),
+                                              size_only(other.size_only), counted_size(other.counted_size)
     {
-        data.insert(data.end(), val.data.begin(), val.data.end());
+        other.data.clear();
+        other.cursor = 0;
+    }
+
+    PackStream &operator=(const PackStream &) = default;
+
+    PackStream &operator=(PackStream &&other) noexcept
+    {
+        data = std::move(other.data);
+        cursor = other.cursor;
+        size_only = other.size_only;
+        counted_size = other.counted_size;
+        other.data.clear();
+        other.cursor = 0;
         return *this;
     }
 
-    PackStream &operator<<(const PackStream &val)
+    //next len unread bytes; valid until the next write in stream.
+    const unsigned char *read_bytes(size_t len)
+    {
+        if (len > size())
+            throw std::out_of_range("PackStream: not enough data for read");
+        auto res = data.data() + cursor;
+        cursor += len;
+        return res;
+    }
+
+    //all writes go here.
+    PackStream &write_bytes(const unsigned char *bytes, size_t len)
     {
-        data.insert(data.end(), val.data.begin(), val.data.end());
+        if (size_only)
+            counted_size += len;
+        else
+            data.insert(data.end(), bytes, bytes + len);
         return *this;
     }
 
-    PackStream &operator<<(const std::vector<unsigned char> &val)
+    void reserve(size_t len)
+    {
+        if (!size_only)
+            data.reserve(data.size() + len);
+    }
+
+    //size of val packed: runs its write without storing data (FixedSizeType: no write).
+    template <typename T>
+    static size_t packed_size(T &val)
+    {
+        if constexpr (FixedSizeType<std::remove_cv_t<T>>)
+            return T::fixed_size;
+
+        PackStream stream;
+        stream.size_only = true;
+        stream << val;
+        return stream.size();
+    }
+
+    //write val; FixedSizeType reserved in advance, others aren't encoded twice for their size.
+    template <typename T>
+    PackStream &pack(T &val)
     {
-        data.insert(data.end(), val.begin(), val.end());
+        if constexpr (FixedSizeType<std::remove_cv_t<T>>)
+            reserve(T::fixed_size);
+        return *this << val;
+    }
+
+    //FixedSizeType: one write_bytes from stack buffer.
+    template <FixedSizeType T>
+    PackStream &write_fixed(const T &val)
+    {
+        unsigned char packed[T::fixed_size];
+        val.write_fixed(packed);
+        return write_bytes(packed, T::fixed_size);
+    }
+
+    template <FixedSizeType T>
+    PackStream &read_fixed(T &val)
+    {
+        val.read_fixed(read_bytes(T::fixed_size));
         return *this;
     }
 
-    PackStream &operator<<(std::vector<unsigned char> &val)
+    //contiguous list of FixedSizeType: one resize, elements written in place.
+    template <FixedSizeType T>
+    PackStream &write_fixed_list(const vector<T> &values)
     {
-        data.insert(data.end(), val.begin(), val.end());
+        auto len = values.size() * T::fixed_size;
+        if (size_only)
+        {
+            counted_size += len;
+            return *this;
+        }
+        auto pos = data.size();
+        data.resize(pos + len);
+        for (auto &v : values)
+        {
+            v.write_fixed(data.data() + pos);
+            pos += T::fixed_size;
+        }
         return *this;
     }
 
-    template <typename T>
+    //count elements of FixedSizeType, appended to values.
+    template <FixedSizeType T>
+    PackStream &read_fixed_list(vector<T> &values, size_t count)
+    {
+        if (count > size() / T::fixed_size)
+            throw std::out_of_range("PackStream: not enough data for read");
+        auto packed = read_bytes(count * T::fixed_size);
+        auto pos = values.size();
+        values.resize(pos + count);
+        for (size_t i = 0; i < count; i++)
+        {
+            values[pos + i].read_fixed(packed + i * T::fixed_size);
+        }
+        return *this;
+    }
+
+    PackStream &operator<<(PackStream &val)
+    {
+        return write_bytes(val.data.data() + val.cursor, val.data.size() - val.cursor);
+    }
+
+    PackStream &operator<<(const PackStream &val)
+    {
+        return write_bytes(val.data.data() + val.cursor, val.data.size() - val.cursor);
+    }
+
+    PackStream &operator<<(const std::vector<unsigned char> &val)
+    {
+        return write_bytes(val.data(), val.size());
+    }
+
+    PackStream &operator<<(std::vector<unsigned char> &val)
+    {
+        return write_bytes(val.data(), val.size());
+    }
+
+    template <RawStreamType T>
     PackStream &operator<<(T &val)
     {
         unsigned char *packed = reinterpret_cast<unsigned char *>(&val);
         int32_t len = sizeof(val) / sizeof(*packed);
 
-        data.insert(data.end(), packed, packed + len);
-        return *this;
+        return write_bytes(packed, len);
     }
 
-    template <typename T>
+    template <RawStreamType T>
     PackStream &operator<<(T val[])
     {
         unsigned char *packed = reinterpret_cast<unsigned char *>(&val);
         int32_t len = sizeof(val) / sizeof(*packed);
-        data.insert(data.end(), packed, packed + len);
-        return *this;
+        return write_bytes(packed, len);
     }
 
     template <StreamObjType T>
@@ -175,61 +311,42 @@ struct PackStream
         return *this;
     }
 
-#define ADDING_INT(num_type, _code)                                   \
-    unsigned char code = _code;                                       \
-    data.push_back(code);                                             \
-    num_type val2 = (num_type)val;                                    \
-    unsigned char *packed = reinterpret_cast<unsigned char *>(&val2); \
-    int32_t len = sizeof(val2) / sizeof(*packed);                     \
-    data.insert(data.end(), packed, packed + len);                    \
-    return *this;
-
+    //varint: code byte + 2/4/8 bytes little-endian, written by one write_bytes.
     template <StreamIntType T>
     PackStream &operator<<(T &val)
     {
-        if (val < 0xfd)
-        {
-            unsigned char packed = (unsigned char)val;
-            data.push_back(packed);
-            return *this;
-        }
-        if (val < 0xffff)
+        if constexpr (std::is_signed_v<T>)
         {
-            ADDING_INT(uint16_t, 0xfd)
+            if (val < 0)
+                throw std::invalid_argument("negative int for varint");
         }
-        if (val < 0xffffffff)
-        {
-            ADDING_INT(uint32_t, 0xfe)
-        }
-        if (val < 0xffffffffffffffff)
+
+        uint64_t value = val;
+        unsigned char packed[9];
+        if (value < 0xfd)
         {
-            ADDING_INT(uint64_t, 0xff)
+            packed[0] = (unsigned char) value;
+            return write_bytes(packed, 1);
         }
 
-        throw std::invalid_argument("int too large for varint");
+        int n = value <= 0xffff ? 0 : (value <= 0xffffffff ? 1 : 2);
+        packed[0] = 0xfd + n;
+        std::memcpy(packed + 1, &value, 2 << n);
+        return write_bytes(packed, 1 + (2 << n));
     }
-#undef ADDING_INT
 
 #define CALC_SIZE(T) (sizeof(T))
 
     PackStream &operator>>(PackStream &val)
     {
-        val.data.insert(val.data.end(), data.begin(), data.end());
+        val.data.insert(val.data.end(), data.begin() + cursor, data.end());
         return *this;
     }
 
-    template <typename T>
+    template <RawStreamType T>
     PackStream &operator>>(T &val)
     {
-		auto _size = CALC_SIZE(T);
-        unsigned char *packed = new unsigned char[_size];
-        for (int i = 0; i < _size; i++)
-        {
-            packed[i] = data[i];
-        }
-		data.erase(data.begin(), data.begin() + _size);
-        auto *res = reinterpret_cast<T *>(packed);
-        val = *res;
+        std::memcpy(&val, read_bytes(CALC_SIZE(T)), CALC_SIZE(T));
         return *this;
     }
 
@@ -246,62 +363,41 @@ struct PackStream
         return *this;
     }
 
-#define GET_INT(num_type)                                  \
-    auto _size = CALC_SIZE(num_type);                      \
-    unsigned char *packed = new unsigned char[_size];      \
-    for (int i = 0; i < _size; i++)                        \
-    {                                                      \
-        packed[i] = data[i];                               \
-    }                                                      \
-    num_type *val2 = reinterpret_cast<num_type *>(packed); \
-    val = *val2;                                           \
-    data.erase(data.begin(), data.begin() + _size);        \
-    delete packed;                                         \
-    return *this;
-
     template <StreamIntType T>
     PackStream &operator>>(T &val)
     {
-        unsigned char code = data.front();
-        data.erase(data.begin(), data.begin() + 1);
+        unsigned char code = *read_bytes(1);
         if (code < 0xfd)
         {
             val = code;
+            return *this;
         }
-        else if (code == 0xfd)
-        {
-            GET_INT(uint16_t)
-        }
-        else if (code == 0xfe)
-        {
-            GET_INT(uint32_t)
-        }
-        else if (code == 0xff)
-        {
-            GET_INT(uint64_t)
-        } else
-		{
-			throw std::runtime_error("error in code StreamIntType");
-		}
+
+        //0xfd, 0xfe, 0xff -> 2, 4, 8 bytes
+        size_t len = 2 << (code - 0xfd);
+        uint64_t value = 0;
+        std::memcpy(&value, read_bytes(len), len);
+        val = (T) value;
         return *this;
     }
 
     unsigned char *bytes() const
     {
-        unsigned char *result = new unsigned char[data.size()];
-        std::copy(data.begin(), data.end(), result);
+        unsigned char *result = new unsigned char[size()];
+        std::copy(data.begin() + cursor, data.end(), result);
         return result;
     }
 
+    //unread bytes.
     size_t size() const
     {
-        return data.size();
+        if (size_only)
+            return counted_size;
+        return data.size() - cursor;
     }
 
     bool isNull() const
     {
-        return data.size() <= 0;
+        return size() <= 0;
     }
 };
-
-#undef GET_INT
\ No newline at end of file
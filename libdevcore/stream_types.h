@@ -5,6 +5,7 @@
 #include <vector>
 #include <list>
 #include <optional>
+#include <array>
 
 #include <btclibs/util/strencodings.h>
 #include <btclibs/uint256.h>
@@ -42,23 +43,44 @@ struct ListType : MakerListType<T>
     {
         auto len = l.size();
         stream << len;
-        for (auto v : l)
+        if constexpr (std::is_same_v<T, unsigned char>)
         {
-            stream << v;
+            //raw bytes, as StrType.
+            return stream.write_bytes(l.data(), l.size());
+        } else if constexpr (FixedSizeType<T>)
+        {
+            return stream.write_fixed_list(l);
+        } else
+        {
+            for (auto &v : l)
+            {
+                //write() of element types isn't const.
+                stream << const_cast<T &>(v);
+            }
+            return stream;
         }
-
-        return stream;
     }
 
     PackStream &read(PackStream &stream)
     {
-        auto len = 0;
+        size_t len;
         stream >> len;
-        for (int i = 0; i < len; i++)
+        if constexpr (std::is_same_v<T, unsigned char>)
         {
-            T temp;
-            stream >> temp;
-            l.push_back(temp);
+            auto packed = stream.read_bytes(len);
+            l.insert(l.end(), packed, packed + len);
+        } else if constexpr (FixedSizeType<T>)
+        {
+            stream.read_fixed_list(l, len);
+        } else
+        {
+            //every element takes at least one byte.
+            l.reserve(l.size() + std::min(len, stream.size()));
+            for (size_t i = 0; i < len; i++)
+            {
+                l.emplace_back();
+                stream >> l.back();
+            }
         }
         return stream;
     }
@@ -92,14 +114,6 @@ struct StrType : public Maker<StrType, string>
 
         value.insert(value.end(), parsedHexData.begin(), parsedHexData.end());
 //        _stream << parsedHexData;
-
-        std::cout << "parsedHexData: ";
-        for (auto v : value)
-        {
-            std::cout << (unsigned int) v << " ";
-        }
-        std::cout << std::endl;
-
 //        _stream >> *this;
 
         return *this;
@@ -108,7 +122,7 @@ struct StrType : public Maker<StrType, string>
     StrType &fromHex(PackStream &hexData)
     {
         value.clear();
-        value.insert(value.end(), hexData.data.begin(), hexData.data.end());
+        value.insert(value.end(), hexData.data.begin() + hexData.cursor, hexData.data.end());
 
         return *this;
     }
@@ -122,23 +136,17 @@ struct StrType : public Maker<StrType, string>
 
     PackStream &write(PackStream &stream) const
     {
-        ListType<unsigned char> list_s(value);
-
-        std::cout << "list_s.l: ";
-        for (auto v : list_s.l){
-            std::cout << (unsigned int) v << " ";
-        }
-        std::cout << std::endl;
         auto _len = value.size();
-        stream << _len << PackStream(value);
-        return stream;
+        stream << _len;
+        return stream.write_bytes(value.data(), value.size());
     }
 
     PackStream &read(PackStream &stream)
     {
-        ListType<unsigned char> list_s;
-        stream >> list_s;
-        value = std::move(list_s.l);
+        size_t len;
+        stream >> len;
+        auto packed = stream.read_bytes(len);
+        value.assign(packed, packed + len);
         return stream;
     }
 
@@ -167,28 +175,28 @@ struct FixedStrType : public Maker<FixedStrType<SIZE>, string>
         str = _str;
     }
 
-    PackStream &write(PackStream &stream) const
+    static constexpr size_t fixed_size = SIZE;
+
+    void write_fixed(unsigned char *out) const
     {
-//        LOG_TRACE << "FixedStrType Worked!";
+        std::memset(out, 0, SIZE);
+        std::memcpy(out, str.data(), std::min(str.size(), (size_t) SIZE));
+    }
 
-        for (auto c : str)
-        {
-            stream << c;
-        }
+    void read_fixed(const unsigned char *in)
+    {
+        str = string(in, in + SIZE);
+    }
 
-        return stream;
+    PackStream &write(PackStream &stream) const
+    {
+//        LOG_TRACE << "FixedStrType Worked!";
+        return stream.write_fixed(*this);
     }
 
     PackStream &read(PackStream &stream)
     {
-        char *c_str = new char[SIZE];
-        for (int i = 0; i < SIZE; i++)
-        {
-            stream >> c_str[i];
-        }
-
-        str = string(c_str, c_str + SIZE);
-        return stream;
+        return stream.read_fixed(*this);
     }
 };
 
@@ -222,40 +230,34 @@ struct IntType : public Maker<IntType<INT_T, BIG_ENDIAN>, INT_T>
         return *this;
     }
 
-    PackStream &write(PackStream &stream)
-    {
-//        LOG_TRACE << "IntType Worked!";
-
-        INT_T value2 = value;
-        unsigned char *packed = reinterpret_cast<unsigned char *>(&value2);
-        int32_t len = sizeof(value2) / sizeof(*packed);
+    static constexpr size_t fixed_size = CALC_SIZE(INT_T);
 
+    void write_fixed(unsigned char *out) const
+    {
+        std::memcpy(out, &value, fixed_size);
         if (BIG_ENDIAN)
-            std::reverse(packed, packed+len);
-
-        PackStream s(packed, len);
-        stream << s;
-
-        return stream;
+            std::reverse(out, out + fixed_size);
     }
 
-    virtual PackStream &read(PackStream &stream)
+    void read_fixed(const unsigned char *in)
     {
-        size_t _len = CALC_SIZE(INT_T);
-        unsigned char *packed = new unsigned char[_len];
-        //int32_t len = sizeof(value2) / sizeof(*packed);
-
-        for (int i = 0; i < _len; i++)
+        std::memcpy(&value, in, fixed_size);
+        if (BIG_ENDIAN)
         {
-            packed[i] = stream.data[i];
+            unsigned char *packed = reinterpret_cast<unsigned char *>(&value);
+            std::reverse(packed, packed + fixed_size);
         }
-        stream.data.erase(stream.data.begin(), stream.data.begin() + _len);
-        if (BIG_ENDIAN)
-            std::reverse(packed, packed+_len);
-        auto *_value = reinterpret_cast<INT_T *>(packed);
-        value = *_value;
+    }
 
-        return stream;
+    PackStream &write(PackStream &stream)
+    {
+//        LOG_TRACE << "IntType Worked!";
+        return stream.write_fixed(*this);
+    }
+
+    PackStream &read(PackStream &stream)
+    {
+        return stream.read_fixed(*this);
     }
 };
 
@@ -289,34 +291,27 @@ struct ULongIntType : public Maker<ULongIntType<INT_T>, INT_T>
         return *this;
     }
 
-    virtual PackStream &write(PackStream &stream)
-    {
-//        LOG_TRACE << "ULongIntType Worked!";
+    static constexpr size_t fixed_size = value_type::WIDTH;
 
-        INT_T value2 = value;
-        unsigned char *packed = reinterpret_cast<unsigned char *>(&value2);
-        int32_t len = std::distance(value2.begin(), value2.end());
+    void write_fixed(unsigned char *out) const
+    {
+        std::copy(value.begin(), value.end(), out);
+    }
 
-        PackStream s(packed, len);
-        stream << s;
+    void read_fixed(const unsigned char *in)
+    {
+        std::copy(in, in + fixed_size, value.begin());
+    }
 
-        return stream;
+    PackStream &write(PackStream &stream)
+    {
+//        LOG_TRACE << "ULongIntType Worked!";
+        return stream.write_bytes(value.begin(), fixed_size);
     }
 
-    virtual PackStream &read(PackStream &stream)
+    PackStream &read(PackStream &stream)
 	{
-		unsigned char *packed = new unsigned char[value_type::WIDTH];
-		//int32_t len = sizeof(value2) / sizeof(*packed);
-
-		for (int i = 0; i < value_type::WIDTH; i++)
-		{
-			packed[i] = stream.data[i];
-		}
-		stream.data.erase(stream.data.begin(), stream.data.begin() + value_type::WIDTH);
-		auto *_value = reinterpret_cast<INT_T *>(packed);
-		value = *_value;
-
-		return stream;
+		return stream.read_fixed(*this);
 	}
 };
 
@@ -330,6 +325,34 @@ struct ULongIntType : public Maker<ULongIntType<INT_T>, INT_T>
 
 #define IntType(bytes) INT##bytes
 
+//constexpr layout of FixedSizeType fields, packed one after another: offsets[i] — position of field i.
+//Whole struct packs/unpacks through one stack buffer.
+template <FixedSizeType... Fields>
+struct FixedLayout
+{
+    static constexpr size_t size = (Fields::fixed_size + ... + 0);
+
+    static constexpr std::array<size_t, sizeof...(Fields)> offsets = []()
+    {
+        std::array<size_t, sizeof...(Fields)> res{};
+        size_t i = 0, pos = 0;
+        ((res[i++] = pos, pos += Fields::fixed_size), ...);
+        return res;
+    }();
+
+    static void write(unsigned char *out, const Fields &... fields)
+    {
+        size_t i = 0;
+        (fields.write_fixed(out + offsets[i++]), ...);
+    }
+
+    static void read(const unsigned char *in, Fields &... fields)
+    {
+        size_t i = 0;
+        (fields.read_fixed(in + offsets[i++]), ...);
+    }
+};
+
 struct VarIntType : public Maker<VarIntType, uint64_t>
 {
     typedef uint64_t value_type;
@@ -423,6 +446,29 @@ public:
         }
     }
 
+    static constexpr size_t fixed_size = []()
+    {
+        if constexpr (FixedSizeType<ObjType>)
+            return ObjType::fixed_size;
+        else
+            return (size_t) 0;
+    }();
+
+    void write_fixed(unsigned char *out) const requires FixedSizeType<ObjType>
+    {
+        if (value.has_value())
+            value.value().write_fixed(out);
+        else
+            none_value.write_fixed(out);
+    }
+
+    void read_fixed(const unsigned char *in) requires FixedSizeType<ObjType>
+    {
+        ObjType _value;
+        _value.read_fixed(in);
+        value = make_optional(_value);
+    }
+
     auto &operator=(ObjType obj)
     {
         value = obj;
@@ -431,8 +477,6 @@ public:
 
     PackStream &write(PackStream &stream)
     {
-        cout << "NonValueType Worked!" << endl;
-
         if (value.has_value())
         {
             value.value().write(stream);
@@ -475,47 +519,22 @@ struct FloatingInteger
         bits = _bits;
     }
 
-    uint256 target()
+    //math.shift_left(bits & 0x00ffffff, 8 * ((bits >> 24) - 3))
+    uint256 target() const
     {
-        arith_uint256 res(bits.value && 0x00ffffff);
-
-        res << (8 * ((bits.value >> 24) - 3));
-
+        arith_uint256 res(bits.value & 0x00ffffff);
+        int32_t shift = 8 * ((int32_t) (bits.value >> 24) - 3);
+        if (shift >= 0)
+            res <<= shift;
+        else
+            res >>= -shift;
         return ArithToUint256(res);
     }
 
-    //TODO: test
+    //bytes count of target + its first 3 bytes (with 0 before byte >= 0x80) = arith_uint256::GetCompact.
     static FloatingInteger from_target_upper_bound(uint256 target)
     {
-        std::string str_n = c2pool::math::natural_to_string(target);
-        list<unsigned char> n;
-        n.insert(n.end(), str_n.begin(), str_n.end());
-
-        if (n.size() > 0 && *n.begin() >= 128)
-        {
-            n.push_front('\0');
-        }
-
-        list<unsigned char> bits2;
-        bits2.push_back((unsigned char)n.size());
-        {
-            list<unsigned char> temp_bits(n);
-            for (int i = 0; i < 3; i++)
-                temp_bits.push_back('\0');
-            auto vi = temp_bits.begin();
-            std::advance(vi, 3);
-            bits2.insert(bits2.end(), temp_bits.begin(), vi);
-        }
-        bits2.reverse();
-
-        IntType(32) unpacked_bits;
-
-        unsigned char *bits = new unsigned char[bits2.size()];
-        std::copy(bits2.begin(), bits2.end(), bits);
-        PackStream stream(bits, bits2.size());
-        stream >> unpacked_bits;
-
-        return FloatingInteger(unpacked_bits);
+        return FloatingInteger((int32_t) UintToArith256(target).GetCompact());
     }
 };
 
@@ -524,6 +543,18 @@ struct FloatingIntegerType
 {
     FloatingInteger bits;
 
+    static constexpr size_t fixed_size = IntType(32)::fixed_size;
+
+    void write_fixed(unsigned char *out) const
+    {
+        bits.bits.write_fixed(out);
+    }
+
+    void read_fixed(const unsigned char *in)
+    {
+        bits.bits.read_fixed(in);
+    }
+
     PackStream &write(PackStream &stream)
     {
         stream << bits.bits;
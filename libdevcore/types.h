@@ -201,7 +201,9 @@ namespace c2pool::messages::stream
             return value;
         }
 
-        PackStream &write(PackStream &stream)
+        static constexpr size_t fixed_size = 16;
+
+        void write_fixed(unsigned char *out) const
         {
             //TODO: IPV6
 //            if ':' in item:
@@ -214,55 +216,53 @@ namespace c2pool::messages::stream
                 throw (std::runtime_error("Invalid address in IPV6AddressType"));
             }
 
-            vector<unsigned int> bits;
-            for (auto bit: split_res) {
-                int bit_int = 0;
+            const unsigned char ipv4_prefix[12]{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff};
+            std::memcpy(out, ipv4_prefix, 12);
+            for (int i = 0; i < 4; i++) {
+                unsigned int bit_int = 0;
                 try {
-                    bit_int = boost::lexical_cast<unsigned int>(bit);
+                    bit_int = boost::lexical_cast<unsigned int>(split_res[i]);
                 } catch (boost::bad_lexical_cast const &) {
                     LOG_ERROR << "Error lexical cast in IPV6AddressType";
                 }
-                bits.push_back(bit_int);
+                out[12 + i] = (unsigned char) bit_int;
             }
-
-            vector<unsigned char> data{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff};
-            for (auto x: bits) {
-                data.push_back((unsigned char) x);
-            }
-
-            PackStream _data(data);
-            stream << _data;
-            return stream;
         }
 
-        PackStream &read(PackStream &stream)
+        void read_fixed(const unsigned char *data)
         {
-            vector<unsigned char> hex_data{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff};
-            if (stream.size() >= 16) {
-                vector<unsigned char> data{stream.data.begin(), stream.data.begin() + 16};
-                stream.data.erase(stream.data.begin(), stream.data.begin() + 16);
-                bool ipv4 = true;
-                for (int i = 0; i < 12; i++) {
-                    if (data[i] != hex_data[i]) {
-                        ipv4 = false;
-                        break;
-                    }
+            const unsigned char hex_data[12]{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff};
+            bool ipv4 = true;
+            for (int i = 0; i < 12; i++) {
+                if (data[i] != hex_data[i]) {
+                    ipv4 = false;
+                    break;
                 }
+            }
 
-                if (ipv4) {
-                    vector<std::string> nums;
-                    for (int i = 12; i < 16; i++) {
-                        auto num = std::to_string((unsigned int) data[i]);
-                        nums.push_back(num);
-                    }
-                    value = boost::algorithm::join(nums, ".");
-                } else {
-                    //TODO: IPV6
+            if (ipv4) {
+                vector<std::string> nums;
+                for (int i = 12; i < 16; i++) {
+                    auto num = std::to_string((unsigned int) data[i]);
+                    nums.push_back(num);
                 }
+                value = boost::algorithm::join(nums, ".");
             } else {
+                //TODO: IPV6
+            }
+        }
+
+        PackStream &write(PackStream &stream)
+        {
+            return stream.write_fixed(*this);
+        }
+
+        PackStream &read(PackStream &stream)
+        {
+            if (stream.size() < fixed_size) {
                 throw std::runtime_error("Invalid address!");
             }
-            return stream;
+            return stream.read_fixed(*this);
         }
     };
 
@@ -272,16 +272,27 @@ namespace c2pool::messages::stream
         IPV6AddressType address; //IPV6AddressType
         IntType<uint16_t, true> port;
 
+        typedef FixedLayout<IntType(64), IPV6AddressType, IntType<uint16_t, true>> layout;
+        static constexpr size_t fixed_size = layout::size;
+
+        void write_fixed(unsigned char *out) const
+        {
+            layout::write(out, services, address, port);
+        }
+
+        void read_fixed(const unsigned char *in)
+        {
+            layout::read(in, services, address, port);
+        }
+
         PackStream &write(PackStream &stream)
         {
-            stream << services << address << port;
-            return stream;
+            return stream.write_fixed(*this);
         }
 
         PackStream &read(PackStream &stream)
         {
-            stream >> services >> address >> port;
-            return stream;
+            return stream.read_fixed(*this);
         }
 
         address_type_stream& operator =(const address_type& val)
@@ -310,16 +321,27 @@ namespace c2pool::messages::stream
             *this = value;
         }
 
+        typedef FixedLayout<IntType(64), address_type_stream> layout;
+        static constexpr size_t fixed_size = layout::size;
+
+        void write_fixed(unsigned char *out) const
+        {
+            layout::write(out, timestamp, address);
+        }
+
+        void read_fixed(const unsigned char *in)
+        {
+            layout::read(in, timestamp, address);
+        }
+
         PackStream &write(PackStream &stream)
         {
-            stream << timestamp << address;
-            return stream;
+            return stream.write_fixed(*this);
         }
 
         PackStream &read(PackStream &stream)
         {
-            stream >> timestamp >> address;
-            return stream;
+            return stream.read_fixed(*this);
         }
 
         addr_stream& operator =(const addr& val)
@@ -2,6 +2,7 @@
 
 #include <boost/range/combine.hpp>
 #include <boost/foreach.hpp>
+#include <algorithm>
 
 #include <networks/network.h>
 #include <libcoind/p2p/p2p_socket.h>
@@ -12,7 +13,7 @@
 namespace c2pool::libnet
 {
 
-    CoindNode::CoindNode(std::shared_ptr<io::io_context> __context, shared_ptr<coind::ParentNetwork> __parent_net, shared_ptr<coind::JSONRPC_Coind> __coind, shared_ptr<ShareTracker> __tracker) : _context(__context), _parent_net(__parent_net), _coind(__coind), _resolver(*_context), work_poller_t(*_context), _tracker(__tracker)
+    CoindNode::CoindNode(std::shared_ptr<io::io_context> __context, shared_ptr<coind::ParentNetwork> __parent_net, shared_ptr<coind::JSONRPC_Coind> __coind, shared_ptr<ShareTracker> __tracker, std::shared_ptr<io::thread_pool> __compute_pool) : _context(__context), _compute_pool(__compute_pool), _parent_net(__parent_net), _coind(__coind), _resolver(*_context), work_poller_t(*_context), _tracker(__tracker)
     {
         LOG_INFO << "CoindNode constructor";
     }
@@ -50,6 +51,10 @@ namespace c2pool::libnet
         coind_work.changed->subscribe([&](getwork_result result){
             set_best_share();
         });
+        //prechecks finished: chains, which waited for them, are verified.
+        _tracker->verifier->prechecked.subscribe([&](){
+            set_best_share();
+        });
         set_best_share();
 
         // p2p logic and join p2pool network
@@ -147,18 +152,22 @@ namespace c2pool::libnet
         PackStream packed_new_header;
         PackShareType(BlockHeaderType, new_header, packed_new_header);
 
-        arith_uint256 hash_header = UintToArith256(_parent_net->POW_FUNC(packed_new_header));
+        arith_uint256 hash_header = UintToArith256(_parent_net->pow_hash(packed_new_header));
         //check that header matches current target
         if (!(hash_header <= UintToArith256(coind_work.value().bits.target())))
             return;
 
         auto coind_best_block = coind_work.value().previous_block;
 
-        PackStream packed_best_block_header;
-        PackShareType(BlockHeaderType, best_block_header.value().value(), packed_best_block_header);
+        auto best_block_hash = [&]()
+        {
+            PackStream packed_best_block_header;
+            PackShareType(BlockHeaderType, best_block_header.value().value(), packed_best_block_header);
+            return coind::data::hash256(packed_best_block_header);
+        };
 
         if (!best_block_header.value().has_value() ||
-            ((new_header.previous_block == coind_best_block) && (coind::data::hash256(packed_best_block_header) == coind_best_block)) ||
+            ((new_header.previous_block == coind_best_block) && (best_block_hash() == coind_best_block)) ||
             ((coind::data::hash256(packed_new_header) == coind_best_block) && (best_block_header.value()->previous_block != coind_best_block)))
         {
             best_block_header = new_header;
@@ -172,12 +181,102 @@ namespace c2pool::libnet
         //TODO: handle_header(protocol->get_block_header(coind_work.value().previous_block));
     }
 
+    int32_t CoindNode::get_block_height(uint256 block_hash, int32_t _default)
+    {
+        auto it = block_heights.find(block_hash);
+        if (it == block_heights.end())
+        {
+            //bounded cache: oldest entries are evicted.
+            if (block_heights_order.size() >= max_block_heights)
+            {
+                block_heights.erase(block_heights_order.front());
+                block_heights_order.pop_front();
+            }
+            it = block_heights.emplace(block_hash, block_height_entry{}).first;
+            block_heights_order.push_back(block_hash);
+        }
+
+        auto &entry = it->second;
+        if (entry.height.has_value())
+            return entry.height.value();
+        if (!entry.pending && std::chrono::steady_clock::now() >= entry.retry_time)
+            request_block_height(block_hash, entry);
+        return _default;
+    }
+
+    void CoindNode::request_block_height(uint256 block_hash, block_height_entry &entry)
+    {
+        entry.pending = true;
+        auto lookup = [this, block_hash]()
+        {
+            std::optional<int32_t> height;
+            try
+            {
+                auto req = std::make_shared<coind::jsonrpc::data::GetBlockHeaderRequest>(block_hash);
+                auto result = _coind->getblockheader(req, true);
+                if (result["error"].isNull())
+                    height = result["result"]["height"].get_int();
+            }
+            catch (const std::exception &ex)
+            {
+                LOG_WARNING << "getblockheader for " << block_hash.GetHex() << " failed: " << ex.what();
+            }
+            //cache is changed only in node context.
+            io::post(*_context, [this, block_hash, height]()
+                     { set_block_height(block_hash, height); });
+        };
+
+        if (_compute_pool)
+            io::post(*_compute_pool, lookup);
+        else
+            io::post(*_context, lookup);
+    }
+
+    void CoindNode::set_block_height(uint256 block_hash, std::optional<int32_t> height)
+    {
+        auto it = block_heights.find(block_hash);
+        //evicted while lookup was pending.
+        if (it == block_heights.end())
+            return;
+
+        auto &entry = it->second;
+        entry.pending = false;
+        entry.height = height;
+        if (!height.has_value())
+        {
+            entry.retry_time = std::chrono::steady_clock::now() + block_height_retry_delay;
+            return;
+        }
+
+        //scores were calculated with height 0 for this block.
+        _tracker->reset_tail_scores();
+        if (rescore_posted)
+            return;
+        rescore_posted = true;
+        io::post(*_context, [this]()
+                 {
+                     rescore_posted = false;
+                     set_best_share();
+                 });
+    }
+
+    int32_t CoindNode::get_height_rel_highest(uint256 block_hash)
+    {
+        //like p2pool height_cacher.call_now(hash, 0): unknown blocks score low until lookup finishes.
+        auto this_height = get_block_height(block_hash, 0);
+        auto best_height = get_block_height(coind_work.value().previous_block, 0);
+        best_block_height = std::max({best_block_height, this_height, best_height});
+        return this_height - best_block_height;
+    }
+
     void CoindNode::set_best_share()
     {
-        //TODO:
-        // auto tracker_think_result = coind()->think(/*TODO: self.get_height_rel_highest, self.coind_work.value['previous_block'], self.coind_work.value['bits'], self.known_txs_var.value*/);
+        //TODO: bits, known_txs for should_punish_reason
+        auto tracker_think_result = _tracker->think([&](uint256 block_hash)
+                                                    { return get_height_rel_highest(block_hash); },
+                                                    coind_work.value().previous_block);
 
-        // best_share_var = tracker_think_result.best;
+        best_share = tracker_think_result.best_hash;
         //TODO: self.desired_var.set(desired)
 
         //TODO:
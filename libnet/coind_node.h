@@ -3,8 +3,12 @@
 #include <memory>
 #include <thread>
 #include <optional>
+#include <map>
+#include <deque>
+#include <chrono>
 
 #include <boost/asio.hpp>
+#include <boost/asio/thread_pool.hpp>
 
 #include <networks/network.h>
 #include <libdevcore/logger.h>
@@ -37,14 +41,16 @@ namespace c2pool::libnet
     {
     private:
         std::shared_ptr<io::io_context> _context; //From NodeManager
+        std::shared_ptr<io::thread_pool> _compute_pool; //From NodeManager; nullptr -> rpc lookups are posted to _context
         ip::tcp::resolver _resolver;
 
     public:
-        CoindNode(std::shared_ptr<io::io_context> __context, shared_ptr<coind::ParentNetwork> __parent_net, shared_ptr<coind::JSONRPC_Coind> __coind, shared_ptr<ShareTracker> __tracker);
+        CoindNode(std::shared_ptr<io::io_context> __context, shared_ptr<coind::ParentNetwork> __parent_net, shared_ptr<coind::JSONRPC_Coind> __coind, shared_ptr<ShareTracker> __tracker, std::shared_ptr<io::thread_pool> __compute_pool = nullptr);
 
         void start();
 
         shared_ptr<ShareTracker> tracker();
+        int32_t get_height_rel_highest(uint256 block_hash);
         void set_best_share();
         void clean_tracker();
 
@@ -69,6 +75,27 @@ namespace c2pool::libnet
         boost::asio::deadline_timer work_poller_t;
         void work_poller();
         void poll_header();
+
+        //Like p2pool height_cacher: think() never waits for coind, unknown heights are requested in background.
+        struct block_height_entry
+        {
+            std::optional<int32_t> height;
+            bool pending = false;
+            //failed lookup (unknown block, rpc error) isn't repeated before.
+            std::chrono::steady_clock::time_point retry_time;
+        };
+        static constexpr size_t max_block_heights = 4096;
+        static constexpr std::chrono::seconds block_height_retry_delay{30};
+
+        map<uint256, block_height_entry> block_heights;
+        std::deque<uint256> block_heights_order; //insertion order for eviction
+        int32_t best_block_height = 0;
+        bool rescore_posted = false; //lookups finished in one turn of context -> one set_best_share
+
+        //cached height or _default, while lookup fills cache.
+        int32_t get_block_height(uint256 block_hash, int32_t _default);
+        void request_block_height(uint256 block_hash, block_height_entry &entry);
+        void set_block_height(uint256 block_hash, std::optional<int32_t> height);
     public:
         void handle_header(const BlockHeaderType &new_header);
 
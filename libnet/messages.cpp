@@ -2,35 +2,43 @@
 
 #include <libdevcore/logger.h>
 #include <libdevcore/str.h>
+#include <cstring>
 
 #include "p2p_socket.h"
 
 namespace c2pool::libnet::messages
 {
-    std::string string_commands(commands cmd)
+    const char *string_commands(commands cmd)
     {
-        try
-        {
-            return _string_commands.at(cmd);
-        }
-        catch (const std::out_of_range &e)
+        auto name = command_table.name(cmd);
+        if (!name)
         {
             LOG_WARNING << (int)cmd << " out of range in string_commands";
             return "error";
         }
+        return name;
     }
 
-    commands reverse_string_commands(std::string key)
+    commands reverse_string_commands(const char *key)
     {
-        try
+        auto entry = command_table.find(coind::p2p::CommandKey::from_name(key));
+        if (!entry)
         {
-            return _reverse_string_commands.at(key);
+            LOG_WARNING << key << " out of range in reverse_string_commands";
+            return commands::cmd_error;
         }
-        catch (const std::out_of_range &e)
+        return entry->cmd;
+    }
+
+    commands reverse_header_command(const char *command)
+    {
+        auto entry = command_table.find(coind::p2p::CommandKey::from_bytes(command));
+        if (!entry)
         {
-            LOG_WARNING << key << " out of range in reverse_string_commands";
+            LOG_WARNING << std::string(command, strnlen(command, coind::p2p::CommandKey::size)) << " out of range in reverse_header_command";
             return commands::cmd_error;
         }
+        return entry->cmd;
     }
 
 } // namespace c2pool::libnet::messages
\ No newline at end of file
@@ -15,6 +15,7 @@
 #include <networks/network.h>
 #include <libdevcore/logger.h>
 #include <libcoind/transaction.h>
+#include <libcoind/p2p/command_table.h>
 
 using namespace c2pool::messages;
 
@@ -45,9 +46,8 @@ namespace c2pool::libnet::messages
         cmd_forget_tx
     };
 
-    //TODO: remake for auto generate:
-    const std::map<commands, std::string> _string_commands = {
-        {cmd_error, "error"},
+    //entry i is command with value i.
+    inline constexpr coind::p2p::CommandTable<commands, 14> command_table({{
         {cmd_version, "version"},
         {cmd_ping, "ping"},
         {cmd_addrme, "addrme"},
@@ -60,28 +60,17 @@ namespace c2pool::libnet::messages
         {cmd_best_block, "best_block"},
         {cmd_have_tx, "have_tx"},
         {cmd_losing_tx, "losing_tx"},
-        {cmd_forget_tx, "forget_tx"}};
-
-    const std::map<std::string, commands> _reverse_string_commands = {
-        {"error", cmd_error},
-        {"version", cmd_version},
-        {"ping", cmd_ping},
-        {"addrme", cmd_addrme},
-        {"addrs", cmd_addrs},
-        {"getaddrs", cmd_getaddrs},
-        //
-        {"shares", cmd_shares},
-        {"sharereq", cmd_sharereq},
-        {"sharereply", cmd_sharereply},
-        {"best_block", cmd_best_block},
-        {"have_tx", cmd_have_tx},
-        {"losing_tx", cmd_losing_tx},
-        {"forget_tx", cmd_forget_tx}
-    };
+        {cmd_remember_tx, "remember_tx"},
+        {cmd_forget_tx, "forget_tx"},
+        {cmd_error, "error"}
+    }});
 
-    std::string string_commands(commands cmd);
+    const char *string_commands(commands cmd);
 
-    commands reverse_string_commands(std::string key);
+    commands reverse_string_commands(const char *key);
+
+    //command from 12 bytes of received message header.
+    commands reverse_header_command(const char *command);
 
     //base_message type for handle
     class raw_message
@@ -89,13 +78,12 @@ namespace c2pool::libnet::messages
         friend c2pool::libnet::p2p::P2PSocket;
 
     public:
+        commands cmd;
         std::string command;
-        // c2pool::libnet::messages::commands name_type;
-        // EnumType<c2pool::libnet::messages::commands> name_type;
         PackStream value;
 
     public:
-        raw_message(std::string  _command) : command(_command)
+        raw_message(commands _cmd, std::string _command) : cmd(_cmd), command(std::move(_command))
         {
         }
 
@@ -107,7 +95,8 @@ namespace c2pool::libnet::messages
 
         PackStream &read(PackStream &stream)
         {
-            value = PackStream(stream);
+            //rest of stream is payload: take buffer without copy.
+            value = std::move(stream);
             return stream;
         }
     };
@@ -313,18 +302,17 @@ namespace c2pool::libnet::messages
         }
     };
 
-    //TODO
     class message_shares : public base_message
     {
     public:
-        std::vector<UniValue> raw_shares;
+        ListType<stream::share_type_stream> raw_shares; //type + contents data
 
     public:
         message_shares() : base_message("shares") {}
 
-        message_shares(std::vector<UniValue> _shares) : base_message("shares")
+        message_shares(std::vector<share_type> _shares) : base_message("shares")
         {
-            raw_shares = _shares;
+            raw_shares = raw_shares.make_type(_shares);
         }
 
         PackStream &write(PackStream &stream) override
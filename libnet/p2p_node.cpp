@@ -23,8 +23,10 @@ using namespace c2pool::libnet;
 
 namespace c2pool::libnet::p2p
 {
-    P2PNode::P2PNode(std::shared_ptr<io::io_context> __context, std::shared_ptr<c2pool::Network> __net, std::shared_ptr<c2pool::dev::coind_config> __config, shared_ptr<c2pool::dev::AddrStore> __addr_store, shared_ptr<c2pool::libnet::CoindNode> __coind_node, shared_ptr<c2pool::shares::ShareTracker> __tracker) : _context(__context), _net(__net), _config(__config), _addr_store(__addr_store), _coind_node(__coind_node), _tracker(__tracker), _resolver(*_context), _acceptor(*_context), _auto_connect_timer(*_context)
+    P2PNode::P2PNode(std::shared_ptr<io::io_context> __context, std::shared_ptr<c2pool::Network> __net, std::shared_ptr<c2pool::dev::coind_config> __config, shared_ptr<c2pool::dev::AddrStore> __addr_store, shared_ptr<c2pool::libnet::CoindNode> __coind_node, shared_ptr<c2pool::shares::ShareTracker> __tracker,
+                     std::shared_ptr<io::io_context> __socket_context, std::shared_ptr<io::thread_pool> __compute_pool) : _net(__net), _config(__config), _context(__context), _socket_context(__socket_context ? __socket_context : __context), _compute_pool(__compute_pool), _addr_store(__addr_store), _coind_node(__coind_node), _tracker(__tracker), _auto_connect_timer(*_context), _resolver(*_context), _acceptor(*_context)
     {
+        peers = std::make_shared<const peers_type>();
         node_id = c2pool::random::RandomNonce();
 
         best_share = __coind_node->best_share;
@@ -54,7 +56,7 @@ namespace c2pool::libnet::p2p
         PackStream packed_header;
         packed_header << header;
 
-        if (_net->parent->POW_FUNC(packed_header) > header.bits.bits.target())
+        if (_net->parent->pow_hash(packed_header) > header.bits.bits.target())
         {
             throw std::invalid_argument("received block header fails PoW test");
         }
@@ -64,13 +66,18 @@ namespace c2pool::libnet::p2p
 
     void P2PNode::listen()
     {
-        _acceptor.async_accept([this](boost::system::error_code ec, ip::tcp::socket socket)
+        //accepted socket belongs to io thread pool; accept handler runs in node context.
+        auto socket = std::make_shared<ip::tcp::socket>(*_socket_context);
+        _acceptor.async_accept(*socket, [this, socket](boost::system::error_code ec)
                                {
                                    if (!ec)
                                    {
                                        //c2pool::libnet::p2p::protocol_handle f = protocol_connected;
-                                       auto _socket = std::make_shared<P2PSocket>(std::move(socket), _net, shared_from_this(), _context);
-                                       server_attempts.insert(_socket);
+                                       auto _socket = std::make_shared<P2PSocket>(std::move(*socket), _net, shared_from_this(), _context);
+                                       {
+                                           std::lock_guard<std::mutex> lock(connections_mutex);
+                                           server_attempts.insert(_socket);
+                                       }
                                        _socket->init(boost::bind(&P2PNode::protocol_listen_connected, this, _1));
                                    }
                                    else
@@ -89,12 +96,20 @@ namespace c2pool::libnet::p2p
                                             //LOG_DEBUG << "AUTO CONNECT";
                                             if (!_ec)
                                             {
-                                                if (!((client_connections.size() < _config->desired_conns) && (_addr_store->len() > 0) && (client_attempts.size() <= _config->max_attempts)))
-                                                    return;
+                                                {
+                                                    std::lock_guard<std::mutex> lock(connections_mutex);
+                                                    if (!((client_connections.size() < _config->desired_conns) && (_addr_store->len() > 0) && (client_attempts.size() <= _config->max_attempts)))
+                                                        return;
+                                                }
                                                 for (auto addr : get_good_peers(1))
                                                 {
                                                     //LOG_TRACE << "for not empty";
-                                                    if (client_attempts.find(std::get<0>(addr)) == client_attempts.end())
+                                                    bool attempted;
+                                                    {
+                                                        std::lock_guard<std::mutex> lock(connections_mutex);
+                                                        attempted = client_attempts.find(std::get<0>(addr)) != client_attempts.end();
+                                                    }
+                                                    if (!attempted)
                                                     {
 
                                                         std::string ip = std::get<0>(addr);
@@ -105,10 +120,13 @@ namespace c2pool::libnet::p2p
                                                             _resolver.async_resolve(ip, port,
                                                                                     [this, ip, port](const boost::system::error_code &er, const boost::asio::ip::tcp::resolver::results_type endpoints)
                                                                                     {
-                                                                                        ip::tcp::socket socket(*_context);
+                                                                                        ip::tcp::socket socket(*_socket_context);
                                                                                         auto _socket = std::make_shared<P2PSocket>(std::move(socket), _net, shared_from_this(), _context);
 
-                                                                                        client_attempts[ip] = _socket;
+                                                                                        {
+                                                                                            std::lock_guard<std::mutex> lock(connections_mutex);
+                                                                                            client_attempts[ip] = _socket;
+                                                                                        }
                                                                                         protocol_handle handle = [this](shared_ptr<c2pool::libnet::p2p::Protocol> protocol)
                                                                                         { return protocol_connected(protocol); };
                                                                                         _socket->connector_init(std::move(handle), endpoints);
@@ -173,10 +191,47 @@ namespace c2pool::libnet::p2p
         }
     }
 
-    std::map<unsigned long long, shared_ptr<c2pool::libnet::p2p::Protocol>>& P2PNode::get_peers(){
+    std::shared_ptr<const P2PNode::peers_type> P2PNode::peers_snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
         return peers;
     }
 
+    P2PNode::peers_type P2PNode::get_peers()
+    {
+        return *peers_snapshot();
+    }
+
+    void P2PNode::add_peer(unsigned long long nonce, shared_ptr<c2pool::libnet::p2p::Protocol> protocol)
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        auto new_peers = std::make_shared<peers_type>(*peers);
+        (*new_peers)[nonce] = protocol;
+        peers = new_peers;
+    }
+
+    void P2PNode::remove_peer(unsigned long long nonce)
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        auto new_peers = std::make_shared<peers_type>(*peers);
+        new_peers->erase(nonce);
+        peers = new_peers;
+    }
+
+    size_t P2PNode::broadcast(std::shared_ptr<c2pool::libnet::messages::base_message> msg, std::function<bool(const shared_ptr<c2pool::libnet::p2p::Protocol> &)> exclude)
+    {
+        auto packed = P2PSocket::pack(msg);
+        size_t count = 0;
+        for (auto &peer : *peers_snapshot())
+        {
+            if (exclude && exclude(peer.second))
+                continue;
+            peer.second->write(packed);
+            count++;
+        }
+        return count;
+    }
+
     unsigned long long P2PNode::get_nonce()
     {
         return node_id;
@@ -184,6 +239,7 @@ namespace c2pool::libnet::p2p
 
     bool P2PNode::is_connected() const
     {
+        std::lock_guard<std::mutex> lock(connections_mutex);
         return client_connections.size();
     }
 
@@ -198,6 +254,7 @@ namespace c2pool::libnet::p2p
         LOG_DEBUG << "P2PNode::protocol_connected";
         if (protocol)
         {
+            std::lock_guard<std::mutex> lock(connections_mutex);
             client_connections.insert(protocol);
             return true;
         }
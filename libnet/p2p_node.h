@@ -5,8 +5,11 @@
 #include <map>
 #include <memory>
 #include <chrono>
+#include <functional>
+#include <mutex>
 
 #include <boost/asio.hpp>
+#include <boost/asio/thread_pool.hpp>
 
 #include <libdevcore/addrStore.h>
 #include <libdevcore/config.h>
@@ -26,6 +29,10 @@ namespace c2pool
     namespace libnet
     {
         class CoindNode;
+        namespace messages
+        {
+            class base_message;
+        }
         namespace p2p
         {
             class Protocol;
@@ -43,17 +50,34 @@ namespace c2pool::libnet::p2p
     class P2PNode : public std::enable_shared_from_this<P2PNode>
     {
     public:
-        P2PNode(std::shared_ptr<io::io_context> __context, std::shared_ptr<c2pool::Network> __net, std::shared_ptr<c2pool::dev::coind_config> __config, shared_ptr<c2pool::dev::AddrStore> __addr_store, shared_ptr<c2pool::libnet::CoindNode> __coind_node, shared_ptr<c2pool::shares::ShareTracker> __tracker);
+        typedef std::map<unsigned long long, shared_ptr<c2pool::libnet::p2p::Protocol>> peers_type;
+
+    public:
+        //__context: node logic and timers (one thread); __socket_context: I/O of P2PSockets (io thread pool), __context if null;
+        //__compute_pool: loading of received shares, inline in __context if null.
+        P2PNode(std::shared_ptr<io::io_context> __context, std::shared_ptr<c2pool::Network> __net, std::shared_ptr<c2pool::dev::coind_config> __config, shared_ptr<c2pool::dev::AddrStore> __addr_store, shared_ptr<c2pool::libnet::CoindNode> __coind_node, shared_ptr<c2pool::shares::ShareTracker> __tracker,
+                std::shared_ptr<io::io_context> __socket_context = nullptr, std::shared_ptr<io::thread_pool> __compute_pool = nullptr);
         void start();
 
         std::vector<addr> get_good_peers(int max_count);
         void got_addr(c2pool::libnet::addr _addr, uint64_t services, int64_t timestamp);
 
-        std::map<unsigned long long, shared_ptr<c2pool::libnet::p2p::Protocol>>& get_peers();
+        //Snapshot of peers; safe to call from any thread.
+        peers_type get_peers();
+        void add_peer(unsigned long long nonce, shared_ptr<c2pool::libnet::p2p::Protocol> protocol);
+        void remove_peer(unsigned long long nonce);
+
+        //Serialize and pack message once, queue shared frame to every peer, except peers for which exclude returns true
+        //(e.g. origin of relayed share). Returns number of peers.
+        size_t broadcast(std::shared_ptr<c2pool::libnet::messages::base_message> msg, std::function<bool(const shared_ptr<c2pool::libnet::p2p::Protocol> &)> exclude = nullptr);
+
         unsigned long long get_nonce();
 
         bool is_connected() const;
 
+        std::shared_ptr<io::io_context> context() const { return _context; }
+        std::shared_ptr<io::thread_pool> compute_pool() const { return _compute_pool; }
+
     public:
         std::vector<shared_ptr<BaseShare>> handle_get_shares(std::vector<uint256> hashes, uint64_t parents, std::vector<uint256> stops, std::tuple<std::string, std::string> peer_addr)
         {
@@ -69,7 +93,11 @@ namespace c2pool::libnet::p2p
                 {
                     if (std::find(stops.begin(), stops.end(), _hash) != stops.end())
                         break;
-                    shares.push_back(_tracker->get(_hash));
+                    auto share = _tracker->get(_hash);
+                    //PoW of share isn't checked yet: don't relay it.
+                    if (!share->prechecked)
+                        break;
+                    shares.push_back(share);
                 }
             }
 
@@ -97,6 +125,8 @@ namespace c2pool::libnet::p2p
         shared_ptr<c2pool::Network> _net;
         shared_ptr<c2pool::dev::coind_config> _config;
         shared_ptr<io::io_context> _context; //From NodeManager;
+        shared_ptr<io::io_context> _socket_context; //From NodeManager;
+        shared_ptr<io::thread_pool> _compute_pool; //From NodeManager;
         shared_ptr<c2pool::dev::AddrStore> _addr_store;
         shared_ptr<c2pool::libnet::CoindNode> _coind_node;
         shared_ptr<c2pool::shares::ShareTracker> _tracker;
@@ -114,10 +144,15 @@ namespace c2pool::libnet::p2p
     private:
         unsigned long long node_id; //nonce
 
+        //connections are guarded by connections_mutex;
+        //peers is copy-on-write: readers (broadcast, get_peers) take snapshot and iterate it without lock.
+        mutable std::mutex connections_mutex;
         map<HOST_IDENT, shared_ptr<P2PSocket>> client_attempts;
         set<shared_ptr<P2PSocket>> server_attempts;
         set<shared_ptr<c2pool::libnet::p2p::Protocol>> client_connections;
         map<HOST_IDENT, int> server_connections;
-        map<unsigned long long, shared_ptr<c2pool::libnet::p2p::Protocol>> peers;
+        std::shared_ptr<const peers_type> peers;
+
+        std::shared_ptr<const peers_type> peers_snapshot() const;
     };
 } // namespace c2pool::p2p
\ No newline at end of file
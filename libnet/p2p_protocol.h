@@ -52,11 +52,16 @@ namespace c2pool::libnet::p2p
             _socket->write(msg);
         }
 
+        void write(std::shared_ptr<const coind::p2p::PackedMessage> msg)
+        {
+            _socket->write(msg);
+        }
+
         virtual void handle(shared_ptr<raw_message> RawMSG)
         {}
 
-        virtual shared_ptr<raw_message> make_raw_message(std::string cmd)
-        { return make_shared<raw_message>(cmd); }
+        virtual shared_ptr<raw_message> make_raw_message(commands cmd, std::string command)
+        { return make_shared<raw_message>(cmd, command); }
     };
 
     class P2P_Protocol : public Protocol
@@ -122,7 +127,7 @@ namespace c2pool::libnet::p2p
         void handle(shared_ptr<raw_message> RawMSG) override
         {
             LOG_DEBUG << "called HANDLE msg in p2p_protocol" << ", with name_type = " << RawMSG->command;
-            switch (reverse_string_commands(RawMSG->command.c_str()))
+            switch (RawMSG->cmd)
             {
                 case commands::cmd_version:
                     handle(GenerateMsg<message_version>(RawMSG->value));
@@ -228,10 +233,6 @@ namespace c2pool::libnet::p2p
             }
 
             //detect duplicate in node->peers
-            if (_p2p_node->get_peers().find(msg->nonce.get()) != _p2p_node->get_peers().end())
-            {
-
-            }
             if (_p2p_node->get_peers().count(msg->nonce.get()) != 0)
             {
                 auto addr = _socket->get_addr();
@@ -265,9 +266,10 @@ namespace c2pool::libnet::p2p
                 _p2p_node->got_addr(std::make_tuple(addr.address.address, std::to_string(addr.address.port)),
                                     addr.address.services, std::min((int64_t) dev::timestamp(), addr.timestamp));
 
-                if ((c2pool::random::RandomFloat(0, 1) < 0.8) && (!_p2p_node->get_peers().empty()))
+                auto peers = _p2p_node->get_peers();
+                if ((c2pool::random::RandomFloat(0, 1) < 0.8) && (!peers.empty()))
                 {
-                    auto _proto = c2pool::random::RandomChoice(_p2p_node->get_peers());
+                    auto _proto = c2pool::random::RandomChoice(peers);
                     std::vector<c2pool::messages::stream::addr_stream> _addrs{addr_record};
                     _proto->write(make_message<message_addrs>(_addrs));
                 }
@@ -281,18 +283,20 @@ namespace c2pool::libnet::p2p
 
             if (host.compare("127.0.0.1") == 0)
             {
-                if ((c2pool::random::RandomFloat(0, 1) < 0.8) && (!_p2p_node->get_peers().empty()))
+                auto peers = _p2p_node->get_peers();
+                if ((c2pool::random::RandomFloat(0, 1) < 0.8) && (!peers.empty()))
                 {
-                    auto _proto = c2pool::random::RandomChoice(_p2p_node->get_peers());
+                    auto _proto = c2pool::random::RandomChoice(peers);
                     _proto->write(make_message<message_addrme>(msg->port.get()));
                 }
             } else
             {
                 _p2p_node->got_addr(std::make_tuple(host, std::to_string(msg->port.get())), other_services,
                                     dev::timestamp());
-                if ((c2pool::random::RandomFloat(0, 1) < 0.8) && (!_p2p_node->get_peers().empty()))
+                auto peers = _p2p_node->get_peers();
+                if ((c2pool::random::RandomFloat(0, 1) < 0.8) && (!peers.empty()))
                 {
-                    auto _proto = c2pool::random::RandomChoice(_p2p_node->get_peers());
+                    auto _proto = c2pool::random::RandomChoice(peers);
                     std::vector<c2pool::messages::addr> _addrs{
                             c2pool::messages::addr(dev::timestamp(), other_services, host, msg->port.get())
                     };
@@ -337,44 +341,76 @@ namespace c2pool::libnet::p2p
         void handle(shared_ptr<message_shares> msg)
         {
             //t0
-            vector<tuple<shared_ptr<c2pool::shares::BaseShare>, vector<UniValue>>> result; //share, txs
-            for (auto wrappedshare: msg->raw_shares)
+            //parsing of contents and load_share done in compute pool, not in node context.
+            //PoW isn't checked here: it's in precheck, run by tracker's VerifyPipeline.
+            auto load_shares = [raw_shares = msg->raw_shares, net = _net, socket = _socket, context = _p2p_node->context()]()
             {
-                int _type = wrappedshare["type"].get_int();
-                if (_type < 17)
-                { //TODO: 17 = minimum share version; move to macros
-                    continue;
-                }
-
-                shared_ptr<c2pool::shares::BaseShare> share = c2pool::shares::load_share(wrappedshare, _net,
-                                                                                         _socket->get_addr());
-                std::vector<UniValue> txs;
-                if (_type >= 13)
+                vector<tuple<shared_ptr<c2pool::shares::BaseShare>, vector<UniValue>>> result; //share, txs
+                try
                 {
-                    for (auto tx_hash: share->new_transaction_hashes)
+                    for (auto raw_share: raw_shares.l)
                     {
-                        //TODO: txs
-                        /*
-                        for tx_hash in share.share_info['new_transaction_hashes']:
-                    if tx_hash in self.node.known_txs_var.value:
-                        tx = self.node.known_txs_var.value[tx_hash]
-                    else:
-                        for cache in self.known_txs_cache.itervalues():
-                            if tx_hash in cache:
-                                tx = cache[tx_hash]
-                                print 'Transaction %064x rescued from peer latency cache!' % (tx_hash,)
-                                break
-                        else:
-                            print >>sys.stderr, 'Peer referenced unknown transaction %064x, disconnecting' % (tx_hash,)
-                            self.disconnect()
-                            return
-                    txs.append(tx)
-                        */
+                        int _type = raw_share.type.value;
+                        if (_type < 17)
+                        { //TODO: 17 = minimum share version; move to macros
+                            continue;
+                        }
+
+                        UniValue contents(UniValue::VOBJ);
+                        contents.read(raw_share.contents.get());
+                        UniValue wrappedshare(UniValue::VOBJ);
+                        wrappedshare.pushKV("type", _type);
+                        wrappedshare.pushKV("contents", contents);
+
+                        shared_ptr<c2pool::shares::BaseShare> share = c2pool::shares::load_share(wrappedshare, net,
+                                                                                                 socket->get_addr());
+                        std::vector<UniValue> txs;
+                        if (_type >= 13)
+                        {
+                            for (auto tx_hash: share->new_transaction_hashes)
+                            {
+                                //TODO: txs
+                                /*
+                                for tx_hash in share.share_info['new_transaction_hashes']:
+                            if tx_hash in self.node.known_txs_var.value:
+                                tx = self.node.known_txs_var.value[tx_hash]
+                            else:
+                                for cache in self.known_txs_cache.itervalues():
+                                    if tx_hash in cache:
+                                        tx = cache[tx_hash]
+                                        print 'Transaction %064x rescued from peer latency cache!' % (tx_hash,)
+                                        break
+                                else:
+                                    print >>sys.stderr, 'Peer referenced unknown transaction %064x, disconnecting' % (tx_hash,)
+                                    self.disconnect()
+                                    return
+                            txs.append(tx)
+                                */
+                            }
+                        }
+                        result.push_back(std::make_tuple(share, txs));
                     }
                 }
-                result.push_back(std::make_tuple(share, txs));
-            }
-            //TODO: p2pNode()->handle_shares(result, shared_from_this()); //TODO: create handle_shares in p2p_node
+                catch (const std::exception &e)
+                {
+                    LOG_WARNING << "Peer sent invalid share: " << e.what() << ", disconnecting";
+                    socket->disconnect();
+                    return;
+                }
+
+                //shares are handled in node context.
+                boost::asio::post(*context, [socket, result]()
+                                  {
+                                      if (!socket->isConnected())
+                                          return;
+                                      //TODO: p2pNode()->handle_shares(result, shared_from_this()); //TODO: create handle_shares in p2p_node
+                                  });
+            };
+
+            if (_p2p_node->compute_pool())
+                boost::asio::post(*_p2p_node->compute_pool(), std::move(load_shares));
+            else
+                load_shares();
 
             /*t1
             if p2pool.BENCH: print "%8.3f ms for %i shares in handle_shares (%3.3f ms/share)" % ((t1-t0)*1000., len(shares), (t1-t0)*1000./ max(1, len(shares))) */
@@ -3,6 +3,7 @@
 #include <memory>
 #include <tuple>
 #include <string>
+#include <cstring>
 
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
@@ -27,25 +28,26 @@ namespace c2pool::libnet::p2p
 {
     //P2PSocket
 
-    P2PSocket::P2PSocket(ip::tcp::socket socket, std::shared_ptr<c2pool::Network> __net, std::shared_ptr<libnet::p2p::P2PNode> __p2p_node, std::shared_ptr<boost::asio::io_context> __context) : _socket(std::move(socket)), _net(__net), _p2p_node(__p2p_node), ping_timer(*__context), auto_disconnect_timer(*__context)
+    P2PSocket::P2PSocket(ip::tcp::socket socket, std::shared_ptr<c2pool::Network> __net, std::shared_ptr<libnet::p2p::P2PNode> __p2p_node, std::shared_ptr<boost::asio::io_context> __context) : _socket(std::move(socket)), _net(__net), _p2p_node(__p2p_node), ping_timer(*__context), auto_disconnect_timer(*__context), _reader(__net->PREFIX, __net->PREFIX_LENGTH), _writer(__net->PREFIX, __net->PREFIX_LENGTH), _context(__context), _strand(_socket.get_executor())
     {
     }
 
     void P2PSocket::connector_init(protocol_handle handle, const boost::asio::ip::tcp::resolver::results_type endpoints)
     {
-        //auto self = shared_from_this();
-        boost::asio::async_connect(_socket, endpoints, [this, handle](boost::system::error_code ec, boost::asio::ip::tcp::endpoint ep)
+        boost::asio::async_connect(_socket, endpoints, boost::asio::bind_executor(_strand, [self = shared_from_this(), handle](boost::system::error_code ec, boost::asio::ip::tcp::endpoint ep)
                                    {
                                        LOG_INFO << "Connect to " << ep.address() << ":" << ep.port();
                                        if (!ec)
                                        {
-                                           init(handle);
+                                           //protocol is created in node context.
+                                           boost::asio::post(*self->_context, [self, handle]()
+                                                             { self->init(handle); });
                                        }
                                        else
                                        {
                                            LOG_ERROR << "async_connect: " << ec << " " << ec.message();
                                        }
-                                   });
+                                   }));
     }
 
     void P2PSocket::init(protocol_handle handle)
@@ -53,6 +55,10 @@ namespace c2pool::libnet::p2p
         LOG_TRACE << "P2PSocket: "
                   << "Start constructor";
 
+        boost::system::error_code ec;
+        _endpoint = _socket.remote_endpoint(ec);
+        _connected = true;
+
         auto proto = std::make_shared<c2pool::libnet::p2p::P2P_Protocol>(shared_from_this(), _net, _p2p_node);
 
         if (handle.empty())
@@ -71,249 +77,126 @@ namespace c2pool::libnet::p2p
         _protocol = proto;
 
         //start reading in socket:
-        start_read();
+        boost::asio::post(_strand, [self = shared_from_this()]()
+                          { self->start_read(); });
     }
 
-    void P2PSocket::write(std::shared_ptr<base_message> msg)
+    void P2PSocket::disconnect()
     {
-        LOG_DEBUG << "P2PSocket::write, msg->cmd = "<< (int)msg->cmd;
-        write_prefix(msg);
-    }
-
-    void P2PSocket::write_prefix(std::shared_ptr<base_message> msg)
-    {
-        LOG_TRACE << "Write prefix method called";
-        boost::asio::async_write(_socket, boost::asio::buffer(_net->PREFIX, _net->PREFIX_LENGTH),
-                                 [this, msg](boost::system::error_code _ec, std::size_t length)
-                                 {
-                                    LOG_DEBUG << "Write prefix called";
-                                     if (_ec)
-                                     {
-                                         LOG_ERROR << "P2PSocket::write()" << _ec << ":" << _ec.message();
-                                         return;
-                                     }
-                                     write_message_data(msg);
-                                 });
+        _connected = false;
+        boost::asio::dispatch(_strand, [self = shared_from_this()]()
+                              {
+                                  boost::system::error_code ec;
+                                  self->_socket.close(ec);
+                              });
     }
 
-    struct SendPackedMsg
+    std::shared_ptr<const coind::p2p::PackedMessage> P2PSocket::pack(std::shared_ptr<base_message> msg)
     {
-        char *data;
-        int32_t len;
-
-        SendPackedMsg(std::shared_ptr<base_message> msg)
+        PackStream payload;
+        payload << *msg;
+        //12 command bytes from compile-time table.
+        auto command = command_table.key(msg->cmd);
+        if (!command)
         {
-            PackStream value;
-
-            //command [+]
-            std::string temp_cmd = c2pool::libnet::messages::string_commands(msg->cmd);
-            auto command = new char[12]{'\0'};
-            memcpy(command, temp_cmd.c_str(), temp_cmd.size());
-            PackStream s_command(command, 12);
-            value << s_command;
-            delete command;
-
-            //-----
-            PackStream payload_stream;
-            payload_stream << *msg;
-
-            //len [+]
-            IntType(32) unpacked_len(payload_stream.size());
-            value << unpacked_len;
-
-            //checksum [+]
-            PackStream payload_checksum_stream;
-            payload_checksum_stream << *msg;
-
-            auto __checksum = coind::data::hash256(payload_checksum_stream);
-            IntType(256) checksum_full(__checksum);
-            PackStream _packed_checksum;
-            _packed_checksum << checksum_full;
-            //TODO: почему результат реверснутый?
-            vector<unsigned char> packed_checksum(_packed_checksum.data.end()-4, _packed_checksum.data.end());
-            std::reverse(packed_checksum.begin(), packed_checksum.end());
-            PackStream checksum(packed_checksum);
-            value << checksum;
-            
-            //payload [+]
-            value << payload_stream;
-
-            //result
-            data = new char[value.size()];
-            memcpy(data, value.bytes(), value.size());
-            len = value.size();
+            LOG_WARNING << (int)msg->cmd << " out of range in command_table";
+            command = command_table.key(cmd_error);
         }
-
-        ~SendPackedMsg()
-        {
-            if (data != nullptr)
-            {
-                delete data;
-            }
-        }
-    };
-
-    void P2PSocket::write_message_data(std::shared_ptr<base_message> _msg)
-    {
-        LOG_DEBUG << "Write msg data method called";
-        SendPackedMsg msg(_msg);
-        boost::asio::async_write(_socket, boost::asio::buffer(msg.data, msg.len),
-                                 //TODO?: this -> shared_this()
-                                 [this](boost::system::error_code _ec, std::size_t length)
-                                 {
-                                     LOG_DEBUG << "Write msg data called";
-                                     if (_ec)
-                                     {
-                                         LOG_ERROR << "P2PSocket::write()" << _ec << ":" << _ec.message();
-                                     }
-                                 });
+        return coind::p2p::PackedMessage::pack(*command, std::move(payload));
     }
 
-    void P2PSocket::start_read()
+    void P2PSocket::write(std::shared_ptr<base_message> msg)
     {
-        LOG_TRACE << "START READING!:";
-        //make raw_message for reading data
-        LOG_TRACE << "protocol count" << _protocol.lock().use_count();
-        shared_ptr<ReadPackedMsg> msg = std::make_shared<ReadPackedMsg>(_net->PREFIX_LENGTH);
-        LOG_TRACE << "created temp_raw_message";
-        //Socket started for reading!
-        read_prefix(msg);
+        LOG_DEBUG << "P2PSocket::write, msg->cmd = "<< (int)msg->cmd;
+        write(pack(msg));
     }
 
-    void P2PSocket::read_prefix(shared_ptr<ReadPackedMsg> msg)
+    void P2PSocket::write(std::shared_ptr<const coind::p2p::PackedMessage> msg)
     {
-        LOG_TRACE << "socket status: " << _socket.is_open();
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->prefix, _net->PREFIX_LENGTH),
-                                [this, msg](boost::system::error_code ec, std::size_t length)
-                                {
-                                    LOG_TRACE << "try to read prefix";
-                                    //TODO: compare
-                                    if (!ec /*&& c2pool::dev::compare_str(tempRawMessage->converter->prefix, _net->PREFIX, tempRawMessage->converter->get_prefix_len())*/)
-                                    {
-                                        LOG_TRACE << "compare prefix";
-                                        //c2pool::python::other::debug_log(tempRawMessage->converter->prefix, _net->PREFIX_LENGTH);
-                                        LOG_TRACE << "after debug_log";
-                                        // LOG_INFO << "MSG: " << tempMessage->command;
-                                        read_command(msg);
-                                    }
-                                    else
-                                    {
-                                        LOG_TRACE << "socket status when error in prefix: " << _socket.is_open();
-                                        LOG_ERROR << "read_prefix: " << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
+        //any thread (node context, broadcast): write queue is changed on strand.
+        boost::asio::dispatch(_strand, [self = shared_from_this(), msg = std::move(msg)]() mutable
+                              {
+                                  //queue holds frame until write completes.
+                                  self->_writer.push(std::move(msg));
+
+                                  //one write outstanding: queued messages are sent after it.
+                                  if (!self->_writer.writing())
+                                      self->start_write();
+                              });
     }
 
-    void P2PSocket::read_command(shared_ptr<ReadPackedMsg> msg)
+    void P2PSocket::start_write()
     {
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->command, msg->COMMAND_LEN),
-                                [this, msg](boost::system::error_code ec, std::size_t /*length*/)
-                                {
-                                    if (!ec)
-                                    {
-                                        LOG_TRACE << "try to read command: " << msg->command;
-                                        //LOG_INFO << "read_command";
-                                        read_length(msg);
-                                    }
-                                    else
-                                    {
-                                        LOG_ERROR << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
-    }
+        auto &buffers = _writer.next_batch();
+        if (buffers.empty())
+            return;
 
-    void P2PSocket::read_length(shared_ptr<ReadPackedMsg> msg)
-    {
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->len, msg->LEN_LEN),
-                                [this, msg](boost::system::error_code ec, std::size_t /*length*/)
-                                {
-                                    if (!ec)
-                                    {
-                                        LOG_TRACE << "try to read length";
-                                        // LOG_INFO << "read_length";
-                                        read_checksum(msg);
-                                    }
-                                    else
-                                    {
-                                        LOG_ERROR << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
+        boost::asio::async_write(_socket, buffers,
+                                 boost::asio::bind_executor(_strand, [self = shared_from_this()](boost::system::error_code _ec, std::size_t length)
+                                 {
+                                     if (_ec)
+                                     {
+                                         LOG_ERROR << "P2PSocket::start_write()" << _ec << ":" << _ec.message();
+                                         self->_writer.clear();
+                                         return;
+                                     }
+                                     self->_writer.complete();
+                                     self->start_write();
+                                 }));
     }
 
-    void P2PSocket::read_checksum(shared_ptr<ReadPackedMsg> msg)
+    void P2PSocket::start_read()
     {
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->checksum, msg->CHECKSUM_LEN),
-                                [this, msg](boost::system::error_code ec, std::size_t /*length*/)
+        //read all available bytes, then frame every complete message from buffer.
+        auto free_space = _reader.prepare();
+        _socket.async_read_some(boost::asio::buffer(free_space.data(), free_space.size()),
+                                boost::asio::bind_executor(_strand, [self = shared_from_this()](boost::system::error_code ec, std::size_t length)
                                 {
-                                    if (!ec)
+                                    if (ec)
                                     {
-                                        LOG_TRACE << "try to read checksum";
-                                        // LOG_INFO << "read_checksum";
-                                        read_payload(msg);
+                                        LOG_ERROR << "P2PSocket::start_read(): " << ec << " " << ec.message();
+                                        self->disconnect();
+                                        return;
                                     }
-                                    else
-                                    {
-                                        LOG_ERROR << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
-    }
-
-    void P2PSocket::read_payload(shared_ptr<ReadPackedMsg> msg)
-    {
-        LOG_TRACE << "read_payload";
-        PackStream stream_len(msg->len, msg->LEN_LEN);
-        IntType(32) payload_len;
-        stream_len >> payload_len;
-        msg->unpacked_len = payload_len.get();
-        msg->payload = new char[msg->unpacked_len+1];
-        LOG_DEBUG << "unpacked_len: " << msg->unpacked_len;
 
-        boost::asio::async_read(_socket,
-                                boost::asio::buffer(msg->payload, msg->unpacked_len),
-                                [this, msg](boost::system::error_code ec, std::size_t length)
-                                {
-                                    if (!ec)
-                                    {
-                                        // LOG_INFO << "read_payload";
-                                        LOG_DEBUG << "HANDLE MESSAGE!";
-                                        final_read_message(msg);
-                                        start_read();
-                                    }
-                                    else
-                                    {
-                                        LOG_ERROR << "read_payload: " << ec << " " << ec.message();
-                                        disconnect();
-                                    }
-                                });
+                                    self->_reader.commit(length);
+                                    std::vector<shared_ptr<raw_message>> msgs;
+                                    self->_reader.frame([&](const char *command, Span<const unsigned char> payload)
+                                                        { msgs.push_back(self->make_raw_message(command, payload)); });
+                                    LOG_TRACE << "P2PSocket: " << msgs.size() << " messages from " << length << " bytes";
+
+                                    //batch handled in node context.
+                                    if (!msgs.empty())
+                                        boost::asio::post(*self->_context, [self, msgs = std::move(msgs)]()
+                                                          { self->handle_messages(msgs); });
+                                    if (self->_connected)
+                                        self->start_read();
+                                }));
     }
 
-    void P2PSocket::final_read_message(shared_ptr<ReadPackedMsg> msg)
+    shared_ptr<raw_message> P2PSocket::make_raw_message(const char *command, Span<const unsigned char> payload)
     {
-        //checksum check
-        //TODO: !!!
-
         //Make raw message
-        PackStream stream_RawMsg;
-
-//        PackStream stream_command(msg->command, msg->COMMAND_LEN);
-        std::string cmd(msg->command);
-        PackStream stream_payload(msg->payload, msg->unpacked_len);
-
-        stream_RawMsg << stream_payload;
+        auto cmd = reverse_header_command(command);
+        std::string cmd_name(command, strnlen(command, coind::p2p::MessageReader::command_len));
+        PackStream stream_RawMsg(std::vector<unsigned char>(payload.begin(), payload.end()));
 
-        shared_ptr<raw_message> RawMessage = _protocol.lock()->make_raw_message(cmd);
-        //RawMessage->name_type = reverse_string_commands(msg->command);
+        auto proto = _protocol.lock();
+        shared_ptr<raw_message> RawMessage = proto ? proto->make_raw_message(cmd, cmd_name) : std::make_shared<raw_message>(cmd, cmd_name);
         stream_RawMsg >> *RawMessage;
+        return RawMessage;
+    }
 
-        //Protocol handle message
-        _protocol.lock()->handle(RawMessage);
+    void P2PSocket::handle_messages(const std::vector<shared_ptr<raw_message>> &msgs)
+    {
+        auto proto = _protocol.lock();
+        for (auto &RawMessage : msgs)
+        {
+            //handler of previous message in batch can disconnect.
+            if (!proto || !_connected)
+                return;
+            //Protocol handle message
+            proto->handle(RawMessage);
+        }
     }
 } // namespace c2pool::p2p
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <memory>
 #include <string>
 #include <tuple>
+#include <vector>
+#include <atomic>
 
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
@@ -11,6 +13,8 @@
 #include <networks/network.h>
 #include <libdevcore/stream.h>
 #include <libdevcore/random.h>
+#include <libcoind/p2p/message_reader.h>
+#include <libcoind/p2p/message_writer.h>
 
 using namespace c2pool::libnet::messages;
 namespace ip = boost::asio::ip;
@@ -26,48 +30,12 @@ namespace c2pool
     }
 } // namespace c2pool
 
-namespace c2pool::libnet::p2p
-{
-    struct ReadPackedMsg
-    {
-        const int COMMAND_LEN = 12;
-        const int LEN_LEN = 4;
-        const int CHECKSUM_LEN = 4;
-
-        char *prefix;
-        char *command;
-        char *len;
-        char *checksum;
-        char *payload;
-
-        int32_t unpacked_len;
-
-        ReadPackedMsg(int32_t pref_len) : payload(NULL)
-        {
-            prefix = new char[pref_len];
-            command = new char[COMMAND_LEN];
-            len = new char[LEN_LEN];
-            checksum = new char[CHECKSUM_LEN];
-        }
-
-        ~ReadPackedMsg()
-        {
-            delete[] prefix;
-            delete[] command;
-            delete[] len;
-            delete[] checksum;
-            if (payload)
-            {
-                delete[] payload;
-            }
-        }
-    };
-}
-
 namespace c2pool::libnet::p2p
 {
     typedef boost::function<bool(std::shared_ptr<c2pool::libnet::p2p::Protocol>)> protocol_handle;
 
+    //I/O of connection (read, framing, write queue) runs on its strand in socket io_context of P2PNode (io thread pool);
+    //Protocol handlers and timers run in node io_context (__context): every read is handled there by one post.
     class P2PSocket : public std::enable_shared_from_this<P2PSocket>
     {
     public:
@@ -79,15 +47,13 @@ namespace c2pool::libnet::p2p
 
         void init(protocol_handle handle);
 
-        bool isConnected() const { return _socket.is_open(); }
+        bool isConnected() const { return _connected; }
         ip::tcp::socket &get() { return _socket; }
-        void disconnect() { _socket.close(); }
+        //safe to call from any thread: socket is closed on its strand.
+        void disconnect();
 
-        ip::tcp::endpoint endpoint()
-        {
-            boost::system::error_code ec;
-            return _socket.remote_endpoint(ec);
-        }
+        //remote endpoint, saved in init().
+        ip::tcp::endpoint endpoint() const { return _endpoint; }
 
         std::tuple<std::string, std::string> get_addr()
         {
@@ -96,18 +62,18 @@ namespace c2pool::libnet::p2p
         }
 
         void write(std::shared_ptr<base_message> msg);
+        //frame packed once, for example by P2PNode::broadcast.
+        void write(std::shared_ptr<const coind::p2p::PackedMessage> msg);
+
+        //Serialize message and pack frame for write.
+        static std::shared_ptr<const coind::p2p::PackedMessage> pack(std::shared_ptr<base_message> msg);
 
     private:
         void start_read();
-        void read_prefix(std::shared_ptr<ReadPackedMsg> msg);
-        void read_command(std::shared_ptr<ReadPackedMsg> msg);
-        void read_length(std::shared_ptr<ReadPackedMsg> msg);
-        void read_checksum(std::shared_ptr<ReadPackedMsg> msg);
-        void read_payload(std::shared_ptr<ReadPackedMsg> msg);
-        void final_read_message(std::shared_ptr<ReadPackedMsg> msg);
+        shared_ptr<raw_message> make_raw_message(const char *command, Span<const unsigned char> payload);
+        void handle_messages(const std::vector<shared_ptr<raw_message>> &msgs);
 
-        void write_prefix(std::shared_ptr<base_message> msg);
-        void write_message_data(std::shared_ptr<base_message> msg);
+        void start_write();
 
     public:
         boost::asio::steady_timer ping_timer;
@@ -118,5 +84,12 @@ namespace c2pool::libnet::p2p
         std::shared_ptr<c2pool::Network> _net;
         std::shared_ptr<libnet::p2p::P2PNode> _p2p_node;
         std::weak_ptr<c2pool::libnet::p2p::Protocol> _protocol;
+        coind::p2p::MessageReader _reader;
+        coind::p2p::MessageWriter _writer;
+
+        std::shared_ptr<boost::asio::io_context> _context;
+        boost::asio::strand<ip::tcp::socket::executor_type> _strand;
+        ip::tcp::endpoint _endpoint;
+        std::atomic<bool> _connected{false};
     };
 } // namespace c2pool::p2p
\ No newline at end of file
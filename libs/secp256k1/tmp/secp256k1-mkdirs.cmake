@@ -0,0 +1,22 @@
+# Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+# file Copyright.txt or https://cmake.org/licensing for details.
+
+cmake_minimum_required(VERSION 3.5)
+
+file(MAKE_DIRECTORY
+  "/root/repo/libs/secp256k1/src/secp256k1"
+  "/root/repo/libs/secp256k1/src/secp256k1-build"
+  "/root/repo/libs/secp256k1"
+  "/root/repo/libs/secp256k1/tmp"
+  "/root/repo/libs/secp256k1/src/secp256k1-stamp"
+  "/root/repo/libs/secp256k1/src"
+  "/root/repo/libs/secp256k1/src/secp256k1-stamp"
+)
+
+set(configSubDirs )
+foreach(subDir IN LISTS configSubDirs)
+    file(MAKE_DIRECTORY "/root/repo/libs/secp256k1/src/secp256k1-stamp/${subDir}")
+endforeach()
+if(cfgdir)
+  file(MAKE_DIRECTORY "/root/repo/libs/secp256k1/src/secp256k1-stamp${cfgdir}") # cfgdir has leading slash
+endif()
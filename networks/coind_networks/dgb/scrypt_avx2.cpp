@@ -0,0 +1,38 @@
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "scrypt_smix.h"
+
+namespace scrypt_avx2
+{
+    namespace
+    {
+        struct Ops
+        {
+            using W = __m256i;
+
+            static W inline Add(W x, W y) { return _mm256_add_epi32(x, y); }
+            static W inline Xor(W x, W y) { return _mm256_xor_si256(x, y); }
+            static W inline Rotl(W x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+            static W inline Load(const uint32_t *p) { return _mm256_loadu_si256((const W *) p); }
+            static void inline Store(uint32_t *p, W x) { _mm256_storeu_si256((W *) p, x); }
+
+            static W inline Gather(const uint32_t *V, const uint32_t j[8], int k)
+            {
+                //word k of V_j[l] for lane l: (j[l] * 32 + k) * 8 + l.
+                auto idx = _mm256_add_epi32(_mm256_slli_epi32(Load(j), 8),
+                                            _mm256_setr_epi32(k * 8, k * 8 + 1, k * 8 + 2, k * 8 + 3, k * 8 + 4, k * 8 + 5, k * 8 + 6, k * 8 + 7));
+                return _mm256_i32gather_epi32((const int *) V, idx, 4);
+            }
+        };
+    }
+
+    void SMix_8way(uint32_t *X, uint32_t *V)
+    {
+        scrypt_smix::SMix<Ops, 8>(X, V);
+    }
+}
+
+#endif
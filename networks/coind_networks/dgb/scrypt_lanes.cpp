@@ -0,0 +1,203 @@
+#include "scrypt_lanes.h"
+#include "scrypt_smix.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <btclibs/crypto/hmac_sha256.h>
+#include <btclibs/crypto/common.h>
+#include <btclibs/compat/cpuid.h>
+
+#if defined(ENABLE_SSE2)
+namespace scrypt_sse2
+{
+    void SMix_4way(uint32_t *X, uint32_t *V);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace scrypt_avx2
+{
+    void SMix_8way(uint32_t *X, uint32_t *V);
+}
+#endif
+
+namespace coind::dgb
+{
+    namespace
+    {
+        const size_t header_size = 80;
+        const size_t hash_size = 32;
+        const int max_lanes = 8;
+
+        struct GenericOps
+        {
+            using W = uint32_t;
+
+            static W inline Add(W x, W y) { return x + y; }
+            static W inline Xor(W x, W y) { return x ^ y; }
+            static W inline Rotl(W x, int n) { return (x << n) | (x >> (32 - n)); }
+            static W inline Load(const uint32_t *p) { return *p; }
+            static void inline Store(uint32_t *p, W x) { *p = x; }
+            static W inline Gather(const uint32_t *V, const uint32_t j[1], int k) { return V[j[0] * scrypt_smix::block_words + k]; }
+        };
+
+        void SMix_1way(uint32_t *X, uint32_t *V)
+        {
+            scrypt_smix::SMix<GenericOps, 1>(X, V);
+        }
+
+        typedef void (*SMixFn)(uint32_t *X, uint32_t *V);
+
+        struct Backend
+        {
+            SMixFn smix;
+            int lanes;
+            std::string name;
+        };
+
+        //V for the widest backend, allocated once per thread.
+        uint32_t *scratchpad()
+        {
+            thread_local std::vector<uint32_t> V(scrypt_smix::N * scrypt_smix::block_words * max_lanes);
+            return V.data();
+        }
+
+        //scrypt of count <= L headers with SMix of L lanes; unused lanes repeat the first header.
+        void scrypt_lanes(const unsigned char *input, unsigned char *output, int count, int L, SMixFn smix)
+        {
+            uint32_t X[scrypt_smix::block_words * max_lanes];
+            std::vector<CHMAC_SHA256> keys;
+            keys.reserve(count);
+
+            //B = PBKDF2-HMAC-SHA256(header, header, 1, 128); HMAC key state is shared by all blocks.
+            unsigned char B[128];
+            unsigned char index[4];
+            for (int l = 0; l < L; l++)
+            {
+                auto header = input + (l < count ? l : 0) * header_size;
+                if (l < count)
+                    keys.emplace_back(header, header_size);
+                CHMAC_SHA256 salted = keys[l < count ? l : 0];
+                salted.Write(header, header_size);
+                for (uint32_t i = 0; i < 4; i++)
+                {
+                    WriteBE32(index, i + 1);
+                    CHMAC_SHA256(salted).Write(index, 4).Finalize(B + i * 32);
+                }
+                for (int k = 0; k < scrypt_smix::block_words; k++)
+                    X[k * L + l] = ReadLE32(B + 4 * k);
+            }
+
+            smix(X, scratchpad());
+
+            //hash = PBKDF2-HMAC-SHA256(header, B', 1, 32)
+            WriteBE32(index, 1);
+            for (int l = 0; l < count; l++)
+            {
+                for (int k = 0; k < scrypt_smix::block_words; k++)
+                    WriteLE32(B + 4 * k, X[k * L + l]);
+                keys[l].Write(B, sizeof(B)).Write(index, 4).Finalize(output + l * hash_size);
+            }
+        }
+
+        //lanes of backend agree with generic SMix.
+        bool SelfTest(int L, SMixFn smix)
+        {
+            unsigned char input[header_size * max_lanes];
+            for (size_t i = 0; i < sizeof(input); i++)
+                input[i] = i * 13 + 5;
+
+            unsigned char expected[hash_size * max_lanes], result[hash_size * max_lanes];
+            for (int l = 0; l < L; l++)
+                scrypt_lanes(input + l * header_size, expected + l * hash_size, 1, 1, SMix_1way);
+            scrypt_lanes(input, result, L, L, smix);
+            return std::memcmp(expected, result, L * hash_size) == 0;
+        }
+
+#if defined(HAVE_GETCPUID)
+        bool AVXEnabled()
+        {
+            uint32_t a, d;
+            __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+            return (a & 6) == 6;
+        }
+#endif
+
+        //widest backend of the CPU, which passes SelfTest; generic SMix otherwise.
+        Backend DetectBackend()
+        {
+            std::vector<Backend> candidates;
+#if defined(HAVE_GETCPUID)
+            uint32_t eax, ebx, ecx, edx;
+            GetCPUID(1, 0, eax, ebx, ecx, edx);
+            bool have_sse2 = (edx >> 26) & 1;
+            bool enabled_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled();
+            GetCPUID(7, 0, eax, ebx, ecx, edx);
+            bool have_avx2 = (ebx >> 5) & 1;
+            (void) have_sse2;
+            (void) enabled_avx;
+            (void) have_avx2;
+
+#if defined(ENABLE_AVX2)
+            if (have_avx2 && enabled_avx)
+                candidates.push_back({scrypt_avx2::SMix_8way, 8, "avx2(8way)"});
+#endif
+#if defined(ENABLE_SSE2)
+            if (have_sse2)
+                candidates.push_back({scrypt_sse2::SMix_4way, 4, "sse2(4way)"});
+#endif
+#endif
+
+            for (const auto &backend : candidates)
+            {
+                if (SelfTest(backend.lanes, backend.smix))
+                    return backend;
+            }
+            return {SMix_1way, 1, "generic"};
+        }
+
+        //detected once, on first use.
+        const Backend &backend()
+        {
+            static const Backend result = DetectBackend();
+            return result;
+        }
+    }
+
+    std::string ScryptAutoDetect()
+    {
+        return backend().name;
+    }
+
+    size_t ScryptLanes()
+    {
+        return backend().lanes;
+    }
+
+    void scrypt_1024_1_1_256_many(const unsigned char *input, unsigned char *output, size_t count)
+    {
+        const auto &impl = backend();
+
+        while (count > 0)
+        {
+            //a few headers are faster one by one, than in mostly empty lanes.
+            if (count * 2 < (size_t) impl.lanes)
+            {
+                scrypt_lanes(input, output, 1, 1, SMix_1way);
+                input += header_size;
+                output += hash_size;
+                count -= 1;
+                continue;
+            }
+
+            auto n = std::min(count, (size_t) impl.lanes);
+            scrypt_lanes(input, output, n, impl.lanes, impl.smix);
+            input += n * header_size;
+            output += n * hash_size;
+            count -= n;
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace coind::dgb
+{
+    //Name of SMix backend selected for the CPU (generic, sse2(4way), avx2(8way)), like SHA256AutoDetect.
+    //Backend is detected once and self-tested; generic SMix is used, if test of wider one fails.
+    std::string ScryptAutoDetect();
+
+    //Headers hashed at once by SMix of selected backend (1, 4 or 8).
+    size_t ScryptLanes();
+
+    //scrypt(N=1024, r=1, p=1, dkLen=32) of 80-byte headers salted with themselves (DigiByte/Litecoin PoW),
+    //up to 8 headers hashed in parallel. input: count * 80 bytes, output: count * 32 bytes.
+    void scrypt_1024_1_1_256_many(const unsigned char *input, unsigned char *output, size_t count);
+}
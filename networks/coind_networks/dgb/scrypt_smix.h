@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+//SMix of scrypt(N=1024, r=1, p=1) for Lanes hashes at once. Ops of backend:
+//  W; W Add(W, W); W Xor(W, W); W Rotl(W, int); W Load(const uint32_t *); void Store(uint32_t *, W);
+//  W Gather(const uint32_t *V, const uint32_t j[Lanes], int k) — word k of V_j[l] for every lane l.
+//Words of lanes are interleaved: word k of lane l is X[k * Lanes + l]; V is 1024 such blocks.
+namespace scrypt_smix
+{
+    const uint32_t N = 1024;
+    const int block_words = 32;
+
+    template <typename Ops, typename W = typename Ops::W>
+    inline void __attribute__((always_inline)) QuarterRound(W &a, W &b, W &c, W &d)
+    {
+        b = Ops::Xor(b, Ops::Rotl(Ops::Add(a, d), 7));
+        c = Ops::Xor(c, Ops::Rotl(Ops::Add(b, a), 9));
+        d = Ops::Xor(d, Ops::Rotl(Ops::Add(c, b), 13));
+        a = Ops::Xor(a, Ops::Rotl(Ops::Add(d, c), 18));
+    }
+
+    template <typename Ops, typename W = typename Ops::W>
+    inline void Salsa8(W B[16])
+    {
+        W x[16];
+        for (int i = 0; i < 16; i++)
+            x[i] = B[i];
+        for (int i = 0; i < 8; i += 2)
+        {
+            //columns
+            QuarterRound<Ops>(x[0], x[4], x[8], x[12]);
+            QuarterRound<Ops>(x[5], x[9], x[13], x[1]);
+            QuarterRound<Ops>(x[10], x[14], x[2], x[6]);
+            QuarterRound<Ops>(x[15], x[3], x[7], x[11]);
+            //rows
+            QuarterRound<Ops>(x[0], x[1], x[2], x[3]);
+            QuarterRound<Ops>(x[5], x[6], x[7], x[4]);
+            QuarterRound<Ops>(x[10], x[11], x[8], x[9]);
+            QuarterRound<Ops>(x[15], x[12], x[13], x[14]);
+        }
+        for (int i = 0; i < 16; i++)
+            B[i] = Ops::Add(B[i], x[i]);
+    }
+
+    //BlockMix_{salsa20/8, 1} in place: B0 = H(B0 ^ B1), B1 = H(B1 ^ B0').
+    template <typename Ops, typename W = typename Ops::W>
+    inline void BlockMix(W B[block_words])
+    {
+        for (int i = 0; i < 16; i++)
+            B[i] = Ops::Xor(B[i], B[16 + i]);
+        Salsa8<Ops>(B);
+        for (int i = 0; i < 16; i++)
+            B[16 + i] = Ops::Xor(B[16 + i], B[i]);
+        Salsa8<Ops>(B + 16);
+    }
+
+    template <typename Ops, int Lanes>
+    void SMix(uint32_t *X, uint32_t *V)
+    {
+        typename Ops::W B[block_words];
+        for (int k = 0; k < block_words; k++)
+            B[k] = Ops::Load(X + k * Lanes);
+
+        for (uint32_t i = 0; i < N; i++)
+        {
+            auto Vi = V + i * block_words * Lanes;
+            for (int k = 0; k < block_words; k++)
+                Ops::Store(Vi + k * Lanes, B[k]);
+            BlockMix<Ops>(B);
+        }
+
+        uint32_t j[Lanes];
+        for (uint32_t i = 0; i < N; i++)
+        {
+            //Integerify: first word of the last 64-byte block.
+            Ops::Store(j, B[16]);
+            for (int l = 0; l < Lanes; l++)
+                j[l] &= N - 1;
+            for (int k = 0; k < block_words; k++)
+                B[k] = Ops::Xor(B[k], Ops::Gather(V, j, k));
+            BlockMix<Ops>(B);
+        }
+
+        for (int k = 0; k < block_words; k++)
+            Ops::Store(X + k * Lanes, B[k]);
+    }
+}
@@ -0,0 +1,37 @@
+#ifdef ENABLE_SSE2
+
+#include <stdint.h>
+#include <emmintrin.h>
+
+#include "scrypt_smix.h"
+
+namespace scrypt_sse2
+{
+    namespace
+    {
+        struct Ops
+        {
+            using W = __m128i;
+
+            static W inline Add(W x, W y) { return _mm_add_epi32(x, y); }
+            static W inline Xor(W x, W y) { return _mm_xor_si128(x, y); }
+            static W inline Rotl(W x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+            static W inline Load(const uint32_t *p) { return _mm_loadu_si128((const W *) p); }
+            static void inline Store(uint32_t *p, W x) { _mm_storeu_si128((W *) p, x); }
+
+            //no gather in SSE2: word of every lane loaded separately.
+            static W inline Gather(const uint32_t *V, const uint32_t j[4], int k)
+            {
+                return _mm_set_epi32(V[(j[3] * 32 + k) * 4 + 3], V[(j[2] * 32 + k) * 4 + 2],
+                                     V[(j[1] * 32 + k) * 4 + 1], V[(j[0] * 32 + k) * 4 + 0]);
+            }
+        };
+    }
+
+    void SMix_4way(uint32_t *X, uint32_t *V)
+    {
+        scrypt_smix::SMix<Ops, 4>(X, V);
+    }
+}
+
+#endif
@@ -4,11 +4,12 @@
 #include <string>
 #include <tuple>
 #include <memory>
+#include <stdexcept>
 
 #include <btclibs/uint256.h>
 // #include <libcoind/jsonrpc/coind.h>
 // #include <libcoind/data.h>
-#include "dgb/scrypt.h"
+#include "dgb/scrypt_lanes.h"
 
 using std::shared_ptr;
 
@@ -56,6 +57,37 @@ namespace coind
 
     uint256 DigibyteParentNetwork::POW_FUNC(PackStream& packed_block_header)
     {
-        //TODO: return coind::data::hash256(packed_block_header);
+        if (packed_block_header.size() != 80)
+            throw std::invalid_argument("POW_FUNC: block header size != 80");
+
+        uint256 result;
+        dgb::scrypt_1024_1_1_256_many(packed_block_header.data.data() + packed_block_header.cursor, result.begin(), 1);
+        return result;
+    }
+
+    std::vector<uint256> DigibyteParentNetwork::POW_FUNC_many(std::vector<PackStream> &packed_block_headers)
+    {
+        //headers in one buffer for lanes.
+        std::vector<unsigned char> headers;
+        headers.reserve(packed_block_headers.size() * 80);
+        for (auto &packed_block_header : packed_block_headers)
+        {
+            if (packed_block_header.size() != 80)
+                throw std::invalid_argument("POW_FUNC_many: block header size != 80");
+            auto begin = packed_block_header.data.begin() + packed_block_header.cursor;
+            headers.insert(headers.end(), begin, begin + 80);
+        }
+
+        std::vector<uint256> result(packed_block_headers.size());
+        if (result.empty())
+            return result;
+        static_assert(sizeof(uint256) == 32);
+        dgb::scrypt_1024_1_1_256_many(headers.data(), result.data()->begin(), result.size());
+        return result;
+    }
+
+    size_t DigibyteParentNetwork::pow_lanes()
+    {
+        return dgb::ScryptLanes();
     }
 } // namespace c2pool
\ No newline at end of file
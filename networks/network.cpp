@@ -22,4 +22,53 @@ namespace coind
     ParentNetwork::ParentNetwork(std::string name) : net_name(name)
     {
     }
+
+    uint256 ParentNetwork::pow_hash(PackStream &packed_block_header)
+    {
+        auto header_hash = PowCache::header_hash(packed_block_header);
+        uint256 result;
+        if (pow_cache.get(header_hash, result))
+            return result;
+
+        result = POW_FUNC(packed_block_header);
+        pow_cache.put(header_hash, result);
+        return result;
+    }
+
+    std::vector<uint256> ParentNetwork::POW_FUNC_many(std::vector<PackStream> &packed_block_headers)
+    {
+        std::vector<uint256> result;
+        result.reserve(packed_block_headers.size());
+        for (auto &packed_block_header : packed_block_headers)
+        {
+            result.push_back(POW_FUNC(packed_block_header));
+        }
+        return result;
+    }
+
+    std::vector<uint256> ParentNetwork::pow_hash_many(std::vector<PackStream> &packed_block_headers)
+    {
+        std::vector<uint256> result(packed_block_headers.size());
+        std::vector<uint256> header_hashes(packed_block_headers.size());
+        std::vector<size_t> missed;
+        std::vector<PackStream> missed_headers;
+        for (size_t i = 0; i < packed_block_headers.size(); i++)
+        {
+            header_hashes[i] = PowCache::header_hash(packed_block_headers[i]);
+            if (pow_cache.get(header_hashes[i], result[i]))
+                continue;
+            missed.push_back(i);
+            missed_headers.push_back(packed_block_headers[i]);
+        }
+        if (missed.empty())
+            return result;
+
+        auto computed = POW_FUNC_many(missed_headers);
+        for (size_t j = 0; j < missed.size(); j++)
+        {
+            result[missed[j]] = computed[j];
+            pow_cache.put(header_hashes[missed[j]], computed[j]);
+        }
+        return result;
+    }
 }
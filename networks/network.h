@@ -7,6 +7,7 @@
 
 #include "btclibs/uint256.h"
 #include <libdevcore/stream.h>
+#include "pow_cache.h"
 
 using std::shared_ptr;
 
@@ -113,6 +114,20 @@ namespace coind
 
         virtual uint256 POW_FUNC(PackStream& packed_block_header) = 0;
         //TODO: virtual /*todo: type*/ POW_FUNC(/*todo: block_header_type.pack(uint256)*/);
+
+        //POW_FUNC of many packed headers; networks with batched PoW override it.
+        virtual std::vector<uint256> POW_FUNC_many(std::vector<PackStream> &packed_block_headers);
+
+        //headers hashed at once by POW_FUNC_many: callers batch that many headers.
+        virtual size_t pow_lanes() { return 1; }
+
+        //POW_FUNC through pow_cache: call sites use it instead of POW_FUNC.
+        uint256 pow_hash(PackStream &packed_block_header);
+
+        //pow_hash of many headers: only headers missed in pow_cache go to POW_FUNC_many.
+        std::vector<uint256> pow_hash_many(std::vector<PackStream> &packed_block_headers);
+
+        PowCache pow_cache;
     };
 
     class DigibyteParentNetwork : public ParentNetwork
@@ -126,6 +141,12 @@ namespace coind
 
         bool version_check(int version) override;
 
+        //scrypt(N=1024, r=1, p=1) of 80-byte header.
         virtual uint256 POW_FUNC(PackStream& packed_block_header) override;
+
+        //headers hashed 4/8 at once by SSE2/AVX2 scrypt lanes.
+        std::vector<uint256> POW_FUNC_many(std::vector<PackStream> &packed_block_headers) override;
+
+        size_t pow_lanes() override;
     };
 }
\ No newline at end of file
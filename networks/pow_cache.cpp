@@ -0,0 +1,116 @@
+#include "pow_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <btclibs/crypto/sha256.h>
+
+namespace coind
+{
+    PowCache::PowCache(size_t capacity) : shard_capacity(std::max<size_t>(1, capacity / shards_count))
+    {
+    }
+
+    uint256 PowCache::header_hash(const PackStream &packed_block_header)
+    {
+        uint256 result;
+        unsigned char out1[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(packed_block_header.data.data() + packed_block_header.cursor, packed_block_header.size()).Finalize(out1);
+        CSHA256().Write(out1, CSHA256::OUTPUT_SIZE).Finalize(result.begin());
+        return result;
+    }
+
+    bool PowCache::get(const uint256 &header_hash, uint256 &pow_hash)
+    {
+        auto &_shard = get_shard(header_hash);
+        std::lock_guard<std::mutex> lock(_shard.mutex);
+        auto item = _shard.items.find(header_hash);
+        if (item == _shard.items.end())
+            return false;
+        pow_hash = item->second;
+        return true;
+    }
+
+    void PowCache::put(const uint256 &header_hash, const uint256 &pow_hash)
+    {
+        auto &_shard = get_shard(header_hash);
+        std::lock_guard<std::mutex> lock(_shard.mutex);
+        if (!_shard.items.emplace(header_hash, pow_hash).second)
+            return;
+        _shard.order.push_back(header_hash);
+        dirty = true;
+        while (_shard.order.size() > shard_capacity)
+        {
+            _shard.items.erase(_shard.order.front());
+            _shard.order.pop_front();
+        }
+    }
+
+    size_t PowCache::size()
+    {
+        size_t result = 0;
+        for (auto &_shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(_shard.mutex);
+            result += _shard.items.size();
+        }
+        return result;
+    }
+
+    bool PowCache::save(const std::string &filepath)
+    {
+        dirty = false;
+        //records of shard in insertion order: load keeps the same eviction order.
+        std::vector<unsigned char> data;
+        for (auto &_shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(_shard.mutex);
+            data.reserve(data.size() + _shard.order.size() * 64);
+            for (auto &header_hash : _shard.order)
+            {
+                auto &pow_hash = _shard.items.at(header_hash);
+                data.insert(data.end(), header_hash.begin(), header_hash.end());
+                data.insert(data.end(), pow_hash.begin(), pow_hash.end());
+            }
+        }
+
+        auto tmp_path = filepath + ".tmp";
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!file.write((const char *) data.data(), data.size()))
+            {
+                dirty = true;
+                return false;
+            }
+        }
+        if (std::rename(tmp_path.c_str(), filepath.c_str()) != 0)
+        {
+            dirty = true;
+            return false;
+        }
+        return true;
+    }
+
+    size_t PowCache::load(const std::string &filepath)
+    {
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file)
+            return 0;
+
+        size_t result = 0;
+        unsigned char record[64];
+        //truncated last record ignored.
+        while (file.read((char *) record, sizeof(record)))
+        {
+            uint256 header_hash, pow_hash;
+            std::copy(record, record + 32, header_hash.begin());
+            std::copy(record + 32, record + 64, pow_hash.begin());
+            put(header_hash, pow_hash);
+            result += 1;
+        }
+        dirty = false;
+        return result;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "btclibs/uint256.h"
+#include <libdevcore/stream.h>
+
+namespace coind
+{
+    //POW_FUNC results by header hash (hash256 of packed block header): share headers come from
+    //several peers, from ShareStore and are checked again in attempt_verify.
+    //Bounded: oldest entries of shard evicted. Lock per shard, so prechecks in worker threads don't wait each other.
+    class PowCache
+    {
+    public:
+        static constexpr size_t shards_count = 16;
+
+    private:
+        struct header_hash_hasher
+        {
+            size_t operator()(const uint256 &hash) const
+            {
+                return hash.GetUint64(0);
+            }
+        };
+
+        struct shard
+        {
+            std::mutex mutex;
+            std::unordered_map<uint256, uint256, header_hash_hasher> items;
+            std::deque<uint256> order; //insertion order, oldest first
+        };
+
+        std::array<shard, shards_count> shards;
+        size_t shard_capacity;
+        //new entries since last save.
+        std::atomic<bool> dirty{false};
+
+        shard &get_shard(const uint256 &header_hash)
+        {
+            return shards[header_hash.GetUint64(1) % shards_count];
+        }
+
+    public:
+        //capacity: total entries, a few share chains of headers by default.
+        PowCache(size_t capacity = 65536);
+
+        static uint256 header_hash(const PackStream &packed_block_header);
+
+        bool get(const uint256 &header_hash, uint256 &pow_hash);
+
+        void put(const uint256 &header_hash, const uint256 &pow_hash);
+
+        size_t size();
+
+        bool is_dirty() const
+        {
+            return dirty;
+        }
+
+        //file of (header_hash, pow_hash) records; written to temp file and renamed.
+        //Entries put during save keep cache dirty for the next one.
+        bool save(const std::string &filepath);
+
+        //number of loaded records; missing file is empty cache. Loaded cache isn't dirty.
+        size_t load(const std::string &filepath);
+    };
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <utility>
+#include <stdexcept>
+#include <cstdint>
+#include <bit>
+#include <btclibs/uint256.h>
+
+namespace c2pool::shares
+{
+    //Open-addressing (linear probing) index by uint256, with values in a contiguous slab.
+    //Low 64 bits of key used as hash: share hashes are uniform, so collisions resolved without 32-byte compares.
+    //Slab index of value is stable until erase, so values can link each other by index instead of iterators;
+    //generation of slot changes on erase, for check that a stored index still points to the same value.
+    template <typename T>
+    class HashIndex
+    {
+    public:
+        typedef std::pair<const uint256, T> value_type;
+        static constexpr int32_t npos = -1;
+
+        class iterator
+        {
+        private:
+            HashIndex *_index = nullptr;
+            int32_t _pos = npos;
+
+        public:
+            iterator() {}
+            iterator(HashIndex *index, int32_t pos) : _index(index), _pos(pos) {}
+
+            int32_t index() const
+            {
+                return _pos;
+            }
+
+            value_type &operator*() const
+            {
+                return *_index->slab[_pos].value;
+            }
+
+            value_type *operator->() const
+            {
+                return &*_index->slab[_pos].value;
+            }
+
+            iterator &operator++()
+            {
+                _pos = _index->next_used(_pos + 1);
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                auto res = *this;
+                ++(*this);
+                return res;
+            }
+
+            bool operator==(const iterator &other) const
+            {
+                return _pos == other._pos;
+            }
+
+            bool operator!=(const iterator &other) const
+            {
+                return _pos != other._pos;
+            }
+        };
+
+    private:
+        struct bucket
+        {
+            uint64_t hash;
+            int32_t pos = npos;
+        };
+
+        struct slot
+        {
+            std::optional<value_type> value;
+            uint32_t generation = 0;
+        };
+
+        std::vector<slot> slab;
+        std::vector<int32_t> free_slots;
+        std::vector<bucket> table;
+        //64 - log2(table.size())
+        int shift = 60;
+        size_t count = 0;
+
+        static uint64_t key_hash(const uint256 &key)
+        {
+            return key.GetUint64(0);
+        }
+
+        size_t bucket_of(uint64_t hash) const
+        {
+            //fibonacci hashing: high bits of product, sequential keys are spread too.
+            return (hash * 0x9E3779B97F4A7C15ull) >> shift;
+        }
+
+        int32_t next_used(int32_t pos) const
+        {
+            while (pos < (int32_t) slab.size() && !slab[pos].value.has_value())
+                pos++;
+            return pos < (int32_t) slab.size() ? pos : npos;
+        }
+
+        //bucket with key or empty bucket, where key must be.
+        size_t find_bucket(const uint256 &key, uint64_t hash) const
+        {
+            auto mask = table.size() - 1;
+            auto i = bucket_of(hash);
+            while (table[i].pos != npos && !(table[i].hash == hash && slab[table[i].pos].value->first == key))
+                i = (i + 1) & mask;
+            return i;
+        }
+
+        void rehash(size_t new_size)
+        {
+            std::vector<bucket> old_table(new_size);
+            old_table.swap(table);
+            shift = 64 - std::countr_zero(new_size);
+            auto mask = table.size() - 1;
+            for (auto &b : old_table)
+            {
+                if (b.pos == npos)
+                    continue;
+                auto i = bucket_of(b.hash);
+                while (table[i].pos != npos)
+                    i = (i + 1) & mask;
+                table[i] = b;
+            }
+        }
+
+    public:
+        HashIndex()
+        {
+            table.resize(16);
+        }
+
+        void reserve(size_t n)
+        {
+            slab.reserve(n);
+            size_t new_size = table.size();
+            while (new_size < n * 2)
+                new_size *= 2;
+            if (new_size != table.size())
+                rehash(new_size);
+        }
+
+        iterator begin()
+        {
+            return iterator(this, next_used(0));
+        }
+
+        iterator end()
+        {
+            return iterator(this, npos);
+        }
+
+        //iterator for slab index; npos -> end()
+        iterator iter(int32_t pos)
+        {
+            return iterator(this, pos);
+        }
+
+        value_type &get(int32_t pos)
+        {
+            return *slab[pos].value;
+        }
+
+        uint32_t generation(int32_t pos) const
+        {
+            return slab[pos].generation;
+        }
+
+        size_t size() const
+        {
+            return count;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        int32_t find_index(const uint256 &key) const
+        {
+            return table[find_bucket(key, key_hash(key))].pos;
+        }
+
+        iterator find(const uint256 &key)
+        {
+            return iterator(this, find_index(key));
+        }
+
+        size_t count_key(const uint256 &key) const
+        {
+            return find_index(key) == npos ? 0 : 1;
+        }
+
+        T &at(const uint256 &key)
+        {
+            auto pos = find_index(key);
+            if (pos == npos)
+                throw std::out_of_range("HashIndex::at");
+            return slab[pos].value->second;
+        }
+
+        template <typename V>
+        std::pair<iterator, bool> insert_or_assign(const uint256 &key, V &&value)
+        {
+            auto hash = key_hash(key);
+            auto i = find_bucket(key, hash);
+            if (table[i].pos != npos)
+            {
+                slab[table[i].pos].value->second = std::forward<V>(value);
+                return {iterator(this, table[i].pos), false};
+            }
+
+            int32_t pos;
+            if (free_slots.empty())
+            {
+                pos = slab.size();
+                slab.emplace_back();
+            }
+            else
+            {
+                pos = free_slots.back();
+                free_slots.pop_back();
+            }
+            slab[pos].value.emplace(key, std::forward<V>(value));
+            table[i].hash = hash;
+            table[i].pos = pos;
+            count += 1;
+
+            if (count * 2 > table.size())
+                rehash(table.size() * 2);
+            return {iterator(this, pos), true};
+        }
+
+        T &operator[](const uint256 &key)
+        {
+            auto pos = find_index(key);
+            if (pos == npos)
+                pos = insert_or_assign(key, T()).first.index();
+            return slab[pos].value->second;
+        }
+
+        size_t erase(const uint256 &key)
+        {
+            auto mask = table.size() - 1;
+            auto i = find_bucket(key, key_hash(key));
+            if (table[i].pos == npos)
+                return 0;
+
+            slab[table[i].pos].value.reset();
+            slab[table[i].pos].generation += 1;
+            free_slots.push_back(table[i].pos);
+            count -= 1;
+
+            //backward shift deletion: no tombstones in table.
+            auto j = i;
+            while (true)
+            {
+                j = (j + 1) & mask;
+                if (table[j].pos == npos)
+                    break;
+                auto k = bucket_of(table[j].hash);
+                //move j to i, if k (home of j) isn't cyclically in (i, j]
+                if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+                    continue;
+                table[i] = table[j];
+                i = j;
+            }
+            table[i].pos = npos;
+            return 1;
+        }
+
+        void erase(iterator it)
+        {
+            erase(uint256(it->first));
+        }
+
+        void clear()
+        {
+            slab.clear();
+            free_slots.clear();
+            table.assign(16, bucket());
+            shift = 60;
+            count = 0;
+        }
+    };
+}
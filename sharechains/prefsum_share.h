@@ -1,26 +1,55 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <queue>
-#include <list>
+#include <vector>
 #include <memory>
 #include <tuple>
+#include <algorithm>
 #include <btclibs/uint256.h>
 #include <btclibs/arith_uint256.h>
 #include <libcoind/data.h>
 #include <boost/function.hpp>
+#include <libdevcore/events.h>
 #include "share.h"
+#include "hash_index.h"
 using namespace std;
 
 namespace c2pool::shares
 {
+    //Prefix-sum offset shared by a tree of shares with one tail.
+    //Elements keep height/work relative to their base, so attaching an orphan tree to its late parent
+    //or dropping its first share shifts a single base instead of every element (union-find with offsets).
+    class chain_base
+    {
+    public:
+        shared_ptr<chain_base> parent; //nullptr for representative
+        int32_t rank = 0;
+        int32_t root = -1; //first share of the tree, valid for representative
+
+        int32_t height = 0;
+        arith_uint256 work;
+        arith_uint256 min_work;
+    };
+
     class element_type
     {
     public:
-        map<uint256, element_type>::iterator prev;
-        list<map<uint256, element_type>::iterator> nexts;
+        //indexes in PrefsumShare::sum, -1 = none; nexts: first next, others linked by sibling.
+        int32_t prev = -1;
+        int32_t next = -1;
+        int32_t sibling = -1;
         shared_ptr<BaseShare> element;
 
+        //skew-binary jump pointer: ancestor on distance jump_dist (0 = none).
+        //https://en.wikipedia.org/wiki/Level_ancestor_problem#Jump_pointer_algorithm
+        int32_t jump = -1;
+        int32_t jump_dist = 0;
+        uint32_t jump_generation = 0; //generation of jump slot in PrefsumShare::sum
+
+        //relative to base, see PrefsumShare::get_sum
+        shared_ptr<chain_base> base;
         int32_t height;
         arith_uint256 work;
         arith_uint256 min_work;
@@ -55,6 +84,7 @@ namespace c2pool::shares
         {
             element_type res = *this;
             res.work += element.work;
+            res.min_work += element.min_work;
             res.height += element.height;
             return res;
         }
@@ -63,6 +93,7 @@ namespace c2pool::shares
         {
             element_type res = *this;
             res.work -= element.work;
+            res.min_work -= element.min_work;
             res.height -= element.height;
             return res;
         }
@@ -70,6 +101,7 @@ namespace c2pool::shares
         element_type operator+=(const element_type &element)
         {
             this->work += element.work;
+            this->min_work += element.min_work;
             this->height += element.height;
             return *this;
         }
@@ -77,6 +109,7 @@ namespace c2pool::shares
         element_type operator-=(const element_type &element)
         {
             this->work -= element.work;
+            this->min_work -= element.min_work;
             this->height -= element.height;
             return *this;
         }
@@ -103,6 +136,7 @@ namespace c2pool::shares
 
         element_delta_type(element_type &el)
         {
+            _none = false;
             head = el.hash();
             tail = el.prev_hash();
             height = el.height;
@@ -142,120 +176,526 @@ namespace c2pool::shares
     class PrefsumShare
     {
     public:
-        map<uint256, shared_ptr<BaseShare>> items;
-        map<uint256, element_type> sum;
+        static constexpr int32_t npos = HashIndex<element_type>::npos;
+
+        HashIndex<shared_ptr<BaseShare>> items;
+        HashIndex<element_type> sum;
+        //first shares of chains by their tail (previous_hash), for attach orphans when tail arrives.
+        map<uint256, vector<int32_t>> roots;
+
+        typedef set<tuple<arith_uint256, uint256>> heads_by_work;
+        //head -> tail; tail -> heads, ordered by cumulative work.
+        map<uint256, uint256> heads;
+        map<uint256, heads_by_work> tails;
+
+        //like p2pool tracker.removed: for every share removed by remove/prune_tail.
+        Event<uint256> share_removed;
 
     protected:
         element_type make_element(shared_ptr<BaseShare> _share)
         {
             element_type element(_share);
-            element.prev = sum.find(_share->previous_hash);
+            element.prev = sum.find_index(_share->previous_hash);
             return element;
         }
 
-    public:
-        void add(shared_ptr<BaseShare> _share)
+        element_type &at(int32_t pos)
         {
-            //TODO: throw if share exists in items;
-            items[_share->hash] = _share;
+            return sum.get(pos).second;
+        }
 
-            element_type new_sum_element = make_element(_share); //only this element
-            if (new_sum_element.prev != sum.end())
+        void add_next(int32_t pos, int32_t next)
+        {
+            at(next).sibling = at(pos).next;
+            at(pos).next = next;
+        }
+
+        void remove_next(int32_t pos, int32_t next)
+        {
+            auto *link = &at(pos).next;
+            while (*link != next)
+                link = &at(*link).sibling;
+            *link = at(next).sibling;
+            at(next).sibling = npos;
+        }
+
+        //representative of base, with path compression.
+        shared_ptr<chain_base> find_base(const shared_ptr<chain_base> &base)
+        {
+            if (!base->parent)
+                return base;
+
+            auto rep = find_base(base->parent);
+            if (base->parent != rep)
             {
-                new_sum_element += new_sum_element.prev->second;
-                sum[_share->hash] = new_sum_element;
-                new_sum_element.prev->second.nexts.push_back(sum.find(_share->hash));
+                base->height += base->parent->height;
+                base->work += base->parent->work;
+                base->min_work += base->parent->min_work;
+                base->parent = rep;
+            }
+            return rep;
+        }
+
+        //attach tree of orphan (representative) to tree of tail (representative); orphan elements shifted by shift.
+        void merge_base(shared_ptr<chain_base> tail, shared_ptr<chain_base> orphan, const element_delta_type &shift)
+        {
+            orphan->height += shift.height;
+            orphan->work += shift.work;
+            orphan->min_work += shift.min_work;
+
+            if (tail->rank < orphan->rank)
+            {
+                tail->height -= orphan->height;
+                tail->work -= orphan->work;
+                tail->min_work -= orphan->min_work;
+                tail->parent = orphan;
+                orphan->root = tail->root;
             }
             else
             {
-                sum[_share->hash] = new_sum_element;
+                orphan->height -= tail->height;
+                orphan->work -= tail->work;
+                orphan->min_work -= tail->min_work;
+                orphan->parent = tail;
+                if (tail->rank == orphan->rank)
+                    tail->rank += 1;
             }
         }
 
-#define set_cur_it(new_value) \
-    cur_it = new_value;       \
-    cur_it_nexts = cur_it->second.nexts
+        //absolute prefix sum of element: from it to the tail of chain.
+        element_delta_type get_sum(int32_t pos)
+        {
+            auto &element = at(pos);
+            auto rep = find_base(element.base);
+
+            element_delta_type res(element);
+            res.height += element.base->height;
+            res.work += element.base->work;
+            res.min_work += element.base->min_work;
+            if (element.base != rep)
+            {
+                res.height += rep->height;
+                res.work += rep->work;
+                res.min_work += rep->min_work;
+            }
+            res.tail = at(rep->root).prev_hash();
+            return res;
+        }
 
-#define get_q() \
-    q.front();  \
-    q.pop()
+        void set_head(uint256 head, uint256 tail, arith_uint256 work)
+        {
+            heads[head] = tail;
+            tails[tail].insert(std::make_tuple(work, head));
+        }
 
-        void remove(uint256 hash)
+        void unset_head(uint256 head, arith_uint256 work)
         {
-            //TODO: throw if hash not exists in items;
-            auto _share = items[hash];
-            items.erase(hash);
+            auto _head = heads.find(head);
+            auto _tail = tails.find(_head->second);
+            _tail->second.erase(std::make_tuple(work, head));
+            if (_tail->second.empty())
+                tails.erase(_tail);
+            heads.erase(_head);
+        }
 
-            queue<map<uint256, element_type>::iterator> q;
-            auto remover = sum[hash];
+        //jump of element can point to already removed share: then jump_dist >= height or slot generation changed.
+        bool has_jump(const element_type &element, int32_t height) const
+        {
+            return element.jump_dist > 0 && element.jump_dist < height && sum.generation(element.jump) == element.jump_generation;
+        }
 
-            auto cur_it = sum.find(hash);
-            auto &cur_it_nexts = cur_it->second.nexts;
+        void make_jump(int32_t pos)
+        {
+            auto &element = at(pos);
+            auto &_prev = at(element.prev);
+            auto prev_height = get_sum(element.prev).height;
+            if (has_jump(_prev, prev_height))
+            {
+                auto &_jump = at(_prev.jump);
+                if (has_jump(_jump, prev_height - _prev.jump_dist) && _prev.jump_dist == _jump.jump_dist)
+                {
+                    element.jump = _jump.jump;
+                    element.jump_dist = 1 + _prev.jump_dist + _jump.jump_dist;
+                    element.jump_generation = _jump.jump_generation;
+                    return;
+                }
+            }
+            element.jump = element.prev;
+            element.jump_dist = 1;
+            element.jump_generation = sum.generation(element.prev);
+        }
 
-            if (remover.nexts.empty())
+        //new shares and merged roots have prev without jump; jumps to shares removed by prune_tail/remove_root are stale.
+        //Walk to the first element with valid jump, then make jumps from the tail side.
+        void repair_jumps(int32_t pos)
+        {
+            vector<int32_t> path;
+            auto height = get_sum(pos).height;
+            while (at(pos).prev != npos && !has_jump(at(pos), height))
             {
-                cur_it = sum.end();
+                path.push_back(pos);
+                pos = at(pos).prev;
+                height -= 1;
             }
-            else
+            for (auto _pos = path.rbegin(); _pos != path.rend(); _pos++)
+            {
+                make_jump(*_pos);
+            }
+        }
+
+        //ancestor of pos on distance n, O(log n); n must be < height.
+        int32_t get_ancestor(int32_t pos, int32_t n)
+        {
+            auto height = get_sum(pos).height;
+            while (n > 0)
             {
-                for (auto item : cur_it_nexts)
+                auto &element = at(pos);
+                if (element.prev != npos && !has_jump(element, height))
+                    repair_jumps(pos);
+
+                if (has_jump(element, height) && element.jump_dist <= n)
+                {
+                    n -= element.jump_dist;
+                    height -= element.jump_dist;
+                    pos = element.jump;
+                }
+                else
                 {
-                    item->second.prev = sum.end(); //remover.prev;
-                    q.push(item);
+                    n -= 1;
+                    height -= 1;
+                    pos = element.prev;
                 }
-                auto new_it = get_q();
-                set_cur_it(new_it);
             }
-            //добавлять все nexts в текущей cur_it в q и проходить их.
-            while (!q.empty() || (cur_it != sum.end()))
+            return pos;
+        }
+
+        //element values relative to new base, after removing share with prefix sum removed.
+        void rebase(int32_t pos, const shared_ptr<chain_base> &base, const element_delta_type &removed)
+        {
+            auto &element = at(pos);
+            auto cur_sum = get_sum(pos) - removed;
+            if (element.next == npos)
+            {
+                unset_head(element.hash(), cur_sum.work + removed.work);
+                set_head(element.hash(), removed.head, cur_sum.work);
+            }
+            element.base = base;
+            element.height = cur_sum.height;
+            element.work = cur_sum.work;
+            element.min_work = cur_sum.min_work;
+            if (element.jump_dist >= cur_sum.height)
+            {
+                element.jump = npos;
+                element.jump_dist = 0;
+            }
+        }
+
+        //remove first share of a tree: shift base of the tree by its values, O(1) + O(heads of tail).
+        //If it has several nexts, all subtrees except the largest get own bases:
+        //BFS over nexts in turn stops, when one subtree left, so cost is size of smaller subtrees.
+        void remove_root(int32_t pos)
+        {
+            auto &remover = at(pos);
+            auto hash = remover.hash();
+            auto removed = get_sum(pos);
+            auto rep = find_base(remover.base);
+            items.erase(hash);
+
+            //heads of this tree move to tail = hash; other trees with same tail have other bases.
+            vector<tuple<arith_uint256, uint256>> tree_heads;
+            for (auto &head : tails[removed.tail])
+            {
+                if (find_base(at(sum.find_index(std::get<1>(head))).base) == rep)
+                    tree_heads.push_back(head);
+            }
+            for (auto &head : tree_heads)
             {
-                if (cur_it != sum.end())
+                unset_head(std::get<1>(head), std::get<0>(head));
+            }
+
+            auto _roots = roots.find(removed.tail);
+            _roots->second.erase(std::find(_roots->second.begin(), _roots->second.end(), pos));
+            if (_roots->second.empty())
+                roots.erase(_roots);
+
+            vector<int32_t> nexts;
+            for (auto next = remover.next; next != npos; next = at(next).sibling)
+            {
+                at(next).prev = npos;
+                roots[hash].push_back(next);
+                nexts.push_back(next);
+            }
+
+            if (!nexts.empty())
+            {
+                vector<queue<int32_t>> queues(nexts.size());
+                vector<vector<int32_t>> visited(nexts.size());
+                for (size_t i = 0; i < nexts.size(); i++)
+                {
+                    queues[i].push(nexts[i]);
+                }
+                auto active = nexts.size();
+                while (active > 1)
                 {
-                    cur_it->second -= remover;
-                    for (auto item : cur_it_nexts)
+                    for (size_t i = 0; i < nexts.size() && active > 1; i++)
                     {
-                        q.push(item);
+                        if (queues[i].empty())
+                            continue;
+                        auto cur = queues[i].front();
+                        queues[i].pop();
+                        visited[i].push_back(cur);
+                        for (auto item = at(cur).next; item != npos; item = at(item).sibling)
+                        {
+                            queues[i].push(item);
+                        }
+                        if (queues[i].empty())
+                            active -= 1;
                     }
                 }
-                if (!q.empty())
+
+                int32_t largest = 0;
+                for (size_t i = 0; i < nexts.size(); i++)
                 {
-                    auto new_it = get_q();
-                    set_cur_it(new_it);
+                    if (!queues[i].empty())
+                    {
+                        largest = i;
+                        continue;
+                    }
+
+                    auto base = std::make_shared<chain_base>();
+                    base->root = nexts[i];
+                    for (auto cur : visited[i])
+                    {
+                        auto &element = at(cur);
+                        auto cur_sum = get_sum(cur) - removed;
+                        element.base = base;
+                        element.height = cur_sum.height;
+                        element.work = cur_sum.work;
+                        element.min_work = cur_sum.min_work;
+                    }
                 }
-                else
+
+                rep->height -= removed.height;
+                rep->work -= removed.work;
+                rep->min_work -= removed.min_work;
+                rep->root = nexts[largest];
+            }
+
+            for (auto &head : tree_heads)
+            {
+                if (std::get<1>(head) != hash)
+                    set_head(std::get<1>(head), hash, std::get<0>(head) - removed.work);
+            }
+            sum.erase(hash);
+            share_removed.happened(hash);
+        }
+
+    public:
+        void add(shared_ptr<BaseShare> _share)
+        {
+            //TODO: throw if share exists in items;
+            items[_share->hash] = _share;
+
+            element_type new_sum_element = make_element(_share); //only this element
+            auto prev = new_sum_element.prev;
+            if (prev != npos)
+            {
+                new_sum_element.base = at(prev).base;
+                new_sum_element += at(prev);
+            }
+            else
+            {
+                new_sum_element.base = std::make_shared<chain_base>();
+            }
+            auto pos = sum.insert_or_assign(_share->hash, new_sum_element).first.index();
+
+            if (prev != npos)
+            {
+                if (at(prev).next == npos)
+                {
+                    unset_head(at(prev).hash(), get_sum(prev).work);
+                }
+                add_next(prev, pos);
+                repair_jumps(pos);
+            }
+            else
+            {
+                new_sum_element.base->root = pos;
+                roots[_share->previous_hash].push_back(pos);
+            }
+            auto delta = get_sum(pos);
+
+            //chains, that waited this share as tail.
+            auto orphans = roots.find(_share->hash);
+            if (orphans != roots.end())
+            {
+                for (auto orphan : orphans->second)
+                {
+                    at(orphan).prev = pos;
+                    add_next(pos, orphan);
+                    merge_base(find_base(at(pos).base), find_base(at(orphan).base), delta);
+                }
+                roots.erase(orphans);
+
+                //heads of attached chains get our tail.
+                auto orphan_heads = tails.extract(_share->hash);
+                for (auto head : orphan_heads.mapped())
+                {
+                    set_head(std::get<1>(head), delta.tail, std::get<0>(head) + delta.work);
+                }
+            }
+            else
+            {
+                set_head(_share->hash, delta.tail, delta.work);
+            }
+        }
+
+        //batch of new shares: parents from batch added before their children,
+        //so every share extends already added chain and prefix sums computed in one pass (no orphans to attach).
+        void add_many(const vector<shared_ptr<BaseShare>> &_shares)
+        {
+            items.reserve(items.size() + _shares.size());
+            sum.reserve(sum.size() + _shares.size());
+
+            HashIndex<int32_t> by_hash;
+            by_hash.reserve(_shares.size());
+            for (int32_t i = 0; i < (int32_t) _shares.size(); i++)
+            {
+                by_hash.insert_or_assign(_shares[i]->hash, i);
+            }
+
+            //children in batch: first child + siblings.
+            vector<int32_t> first_child(_shares.size(), npos), sibling(_shares.size(), npos);
+            vector<int32_t> order;
+            order.reserve(_shares.size());
+            for (int32_t i = 0; i < (int32_t) _shares.size(); i++)
+            {
+                auto parent = by_hash.find(_shares[i]->previous_hash);
+                if (parent == by_hash.end())
+                {
+                    order.push_back(i);
+                    continue;
+                }
+                sibling[i] = first_child[parent->second];
+                first_child[parent->second] = i;
+            }
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                for (auto child = first_child[order[i]]; child != npos; child = sibling[child])
+                {
+                    order.push_back(child);
+                }
+            }
+
+            for (auto i : order)
+            {
+                add(_shares[i]);
+            }
+        }
+
+        void remove(uint256 hash)
+        {
+            auto pos = sum.find_index(hash);
+            if (pos == npos)
+            {
+                throw invalid_argument("[remove] hash not exists in sum");
+            }
+            if (at(pos).prev == npos)
+            {
+                remove_root(pos);
+                return;
+            }
+            items.erase(hash);
+
+            auto &remover = at(pos);
+            auto removed = get_sum(pos);
+            if (remover.next == npos)
+            {
+                unset_head(hash, removed.work);
+            }
+            remove_next(remover.prev, pos);
+            if (at(remover.prev).next == npos)
+            {
+                set_head(at(remover.prev).hash(), removed.tail, get_sum(remover.prev).work);
+            }
+
+            //every next becomes first share of a new chain with tail = hash: rebase its subtree.
+            for (auto next = remover.next; next != npos; next = at(next).sibling)
+            {
+                at(next).prev = npos;
+                roots[hash].push_back(next);
+
+                auto base = std::make_shared<chain_base>();
+                base->root = next;
+
+                queue<int32_t> q;
+                q.push(next);
+                while (!q.empty())
                 {
-                    break;
+                    auto cur = q.front();
+                    q.pop();
+                    rebase(cur, base, removed);
+                    for (auto item = at(cur).next; item != npos; item = at(item).sibling)
+                    {
+                        q.push(item);
+                    }
                 }
             }
             sum.erase(hash);
+            share_removed.happened(hash);
         }
-#undef set_cur_it
-#undef get_q
 
-        bool is_child_of(uint256 item_hash, uint256 possible_child_hash)
+        //remove n shares from the tail side of chain with hash, O(n) for chain without forks at the tail.
+        void prune_tail(uint256 hash, int32_t n)
         {
-            auto _it = sum.find(item_hash);
-            if (sum.find(possible_child_hash) == sum.end())
+            auto pos = sum.find_index(hash);
+            if (pos == npos || n > get_sum(pos).height)
             {
-                throw invalid_argument("is_child_of: possible_child_hash existn't in tracker");
+                throw invalid_argument("[prune_tail] hash not exists in sum or n > height");
             }
-            while (_it != sum.end())
+            if (n <= 0)
+                return;
+
+            //ancestor on height n, then walk to the first share.
+            vector<int32_t> path;
+            for (auto cur = get_ancestor(pos, get_sum(pos).height - n); cur != npos; cur = at(cur).prev)
             {
-                if (_it->second.prev->first == possible_child_hash)
-                    return true;
-                else
-                    _it = _it->second.prev;
+                path.push_back(cur);
+            }
+            for (auto cur = path.rbegin(); cur != path.rend(); cur++)
+            {
+                remove_root(*cur);
+            }
+        }
+
+        //true, if possible_child_hash is ancestor of item_hash.
+        bool is_child_of(uint256 item_hash, uint256 possible_child_hash)
+        {
+            auto possible_pos = sum.find_index(possible_child_hash);
+            if (possible_pos == npos)
+            {
+                throw invalid_argument("is_child_of: possible_child_hash existn't in tracker");
             }
-            return false;
+            auto pos = sum.find_index(item_hash);
+            if (pos == npos)
+                return false;
+
+            auto height = get_sum(pos).height;
+            auto possible_height = get_sum(possible_pos).height;
+            if (possible_height >= height)
+                return false;
+            return get_ancestor(pos, height - possible_height) == possible_pos;
         }
 
         element_delta_type get_delta(uint256 first_hash, uint256 second_hash)
         {
-            if (sum.find(first_hash) == sum.end())
+            auto first_pos = sum.find_index(first_hash);
+            if (first_pos == npos)
             {
                 throw invalid_argument("first_hash in get_delta existn't in sum!");
             }
-            if (sum.find(second_hash) == sum.end())
+            auto second_pos = sum.find_index(second_hash);
+            if (second_pos == npos)
             {
                 throw invalid_argument("second in get_delta existn't in sum!");
             }
@@ -266,40 +706,22 @@ namespace c2pool::shares
                 //return element_delta_type();
             }
 
-            element_delta_type fir(sum[first_hash]);
-            element_delta_type sec(sum[second_hash]);
-            return fir - sec;
+            return get_sum(first_pos) - get_sum(second_pos);
         }
 
-        //todo: create optimization like get_last_iterator
         uint256 get_last(uint256 hash)
         {
-            auto _it = sum.find(hash);
-            if (_it == sum.end())
-            {
-                throw invalid_argument("[get_last] hash not exists in sum");
-            }
-            //cout << _it->second.element;
-            auto last = _it->second.prev_hash();
-            while (_it != sum.end())
-            {
-                last = _it->second.prev_hash();
-                _it = _it->second.prev;
-                // this_thread::sleep_for(chrono::milliseconds(1));
-            }
-            return last;
+            return get_delta_to_last(hash).tail;
         }
 
         element_delta_type get_delta_to_last(uint256 hash)
         {
-            auto el = sum.find(hash);
-            if (el == sum.end())
+            auto pos = sum.find_index(hash);
+            if (pos == npos)
             {
                 throw invalid_argument("[get_delta_to_last] hash not exists in sum");
             }
-            element_delta_type delta(el->second);
-            delta.tail = get_last(hash);
-            return delta;
+            return get_sum(pos);
         }
 
         uint256 get_work(uint256 hash)
@@ -312,27 +734,40 @@ namespace c2pool::shares
             return get_delta_to_last(hash).height;
         }
 
-        //todo: get_best
-        uint256 get_test_best()
+        //head with max cumulative work of chains with tail.
+        uint256 get_best_head(uint256 tail)
         {
-            if (items.empty())
+            auto _tail = tails.find(tail);
+            if (_tail == tails.end())
             {
                 uint256 res;
                 res.SetNull();
                 return res;
             }
-            auto best = items.begin()->second->hash;
-            for (auto item : items)
+            return std::get<1>(*_tail->second.rbegin());
+        }
+
+        //head with max cumulative work, O(tails).
+        uint256 get_best()
+        {
+            uint256 res;
+            res.SetNull();
+            arith_uint256 best_work;
+            for (auto &_tail : tails)
             {
-                if (item.second->hash > best)
-                    best = item.second->hash;
+                auto &head = *_tail.second.rbegin();
+                if (res.IsNull() || std::get<0>(head) > best_work)
+                {
+                    best_work = std::get<0>(head);
+                    res = std::get<1>(head);
+                }
             }
-            return best;
+            return res;
         }
 
         bool exists(uint256 hash)
         {
-            return (items.find(hash) != items.end());
+            return items.find_index(hash) != npos;
         }
 
         tuple<int32_t, uint256> get_height_and_last(uint256 hash)
@@ -368,25 +803,17 @@ namespace c2pool::shares
 
         virtual uint256 get_nth_parent_hash(uint256 hash, int32_t n)
         {
-            auto it = sum.find(hash);
-            int32_t dist = 0;
-            while ((dist != n) && (it != sum.end()))
+            auto pos = sum.find_index(hash);
+            if (pos == npos || n > get_sum(pos).height)
             {
-                dist += 1;
-                if (dist == n)
-                {
-                    break;
-                }
-                it = it->second.prev;
+                throw invalid_argument((boost::format("in get_nth_parent_hash(%1%, %2%): n < chain for this hash") % hash.ToString() % n).str());
             }
-            if (it == sum.end())
+            if (n == 0)
             {
-                throw invalid_argument((boost::format("in get_nth_parent_hash(%1%, %2%): n < chain for this hash") % hash.ToString() % n).str());
+                return hash;
             }
-            assert(dist == n);
-            return it->second.prev_hash();
+            return at(get_ancestor(pos, n - 1)).prev_hash();
         }
-        //todo: remove range
     };
 
     class PrefsumVerifiedShare : public PrefsumShare
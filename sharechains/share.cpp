@@ -35,7 +35,14 @@ using namespace std;
 //	// contents = ShareValue["contents"].get_obj();
 //}
 
-bool BaseShare::check(shared_ptr<ShareTracker> tracker /*, TODO: other_txs = None???*/)
+void BaseShare::precheck()
+{
+	precheck_header();
+	auto _packed_header = packed_header();
+	check_pow(net->parent->pow_hash(_packed_header));
+}
+
+void BaseShare::precheck_header()
 {
 	if (timestamp > (c2pool::dev::timestamp() + 600))
 	{
@@ -44,6 +51,30 @@ bool BaseShare::check(shared_ptr<ShareTracker> tracker /*, TODO: other_txs = Non
 				 (timestamp - c2pool::dev::timestamp())).str());
 	}
 
+	if (target.Compare(net->MAX_TARGET) > 0)
+	{
+		throw std::invalid_argument("share target invalid");
+	}
+}
+
+PackStream BaseShare::packed_header()
+{
+	PackStream result;
+	result << BlockHeaderType_stream(header);
+	return result;
+}
+
+void BaseShare::check_pow(const uint256 &_pow_hash)
+{
+	pow_hash = _pow_hash;
+	if (pow_hash.Compare(target) > 0)
+	{
+		throw std::invalid_argument("share PoW invalid");
+	}
+}
+
+bool BaseShare::check(shared_ptr<ShareTracker> tracker /*, TODO: other_txs = None???*/)
+{
 	if (!previous_hash.IsNull()) //TODO: or pack in share_data
 	{
 		auto previous_share = tracker->get(previous_hash);
@@ -77,17 +108,21 @@ bool BaseShare::check(shared_ptr<ShareTracker> tracker /*, TODO: other_txs = Non
 //
 //	desired_version = share_data["desired_version"].get_uint64();
 //
+//	vector<uint256> _new_transaction_hashes;
 //	for (auto item: share_info["new_transaction_hashes"].getValues())
 //	{
 //		uint256 tx_hash;
 //		tx_hash.SetHex(item.get_str());
-//		new_transaction_hashes.push_back(tx_hash);
+//		_new_transaction_hashes.push_back(tx_hash);
 //	}
+//	new_transaction_hashes = _new_transaction_hashes;
 //
+//	vector<tuple<int, int>> _transaction_hash_refs;
 //	for (auto tx_hash_ref: share_info["transaction_hash_refs"].getValues())
 //	{
-//		transaction_hash_refs.push_back(std::make_tuple<int, int>(tx_hash_ref[0].get_int(), tx_hash_ref[1].get_int()));
+//		_transaction_hash_refs.push_back(std::make_tuple<int, int>(tx_hash_ref[0].get_int(), tx_hash_ref[1].get_int()));
 //	}
+//	transaction_hash_refs = _transaction_hash_refs;
 //
 //	far_share_hash.SetHex(share_info["far_share_hash"].get_str());
 //	max_target.SetHex(share_info["max_bits"].get_str());
@@ -227,16 +262,12 @@ BaseShare::BaseShare(int VERSION, shared_ptr<c2pool::Network> _net, tuple<string
 
 	*/
 
+	//cheap check on load; target again and PoW are checked in precheck.
 	if (target.Compare(net->MAX_TARGET) > 0)
 	{
 		throw std::runtime_error("share target invalid");
 	}
 
-	if (pow_hash.Compare(target) > 0)
-	{
-		throw std::runtime_error("share PoW invalid");
-	}
-
 	time_seen = c2pool::dev::timestamp();
 }
 
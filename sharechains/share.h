@@ -16,10 +16,12 @@ using dbshell::DBObject;
 #include <tuple>
 #include <vector>
 #include <map>
+#include <optional>
 using std::shared_ptr, std::string, std::make_shared;
 using std::vector, std::tuple, std::map;
 
 #include "shareTypes.h"
+#include "share_tx_data.h"
 #include "data.h"
 class ShareTracker;
 
@@ -33,7 +35,9 @@ protected:
 	ShareType_stream share_type_data;
 
 public:
-
+    //compact: tx hashes interned in TxHashTable, refs packed as uint16/uint32.
+    c2pool::shares::ShareTxHashes new_transaction_hashes;
+    c2pool::shares::PackedTxRefs transaction_hash_refs; //pairs of share_count, tx_count
 
 //public:
 //    SmallBlockHeaderType min_header;
@@ -55,8 +59,6 @@ public:
 //    unsigned long long desired_version;
 //    //===================================
 //
-//    vector<uint256> new_transaction_hashes;
-//    vector<tuple<int, int>> transaction_hash_refs; //TODO: check+test; # pairs of share_count, tx_count
 //    uint256 far_share_hash;
 //    uint256 max_target; //from max_bits;
 //    uint256 target;     //from bits;
@@ -91,6 +93,17 @@ public:
 //
 //    virtual UniValue to_contents();
 
+    //checks without tracker: timestamp, target, PoW; throws on bad share. Thread-safe for different shares, so run in VerifyPipeline.
+    //On load only target is checked: shares with unchecked PoW are in tracker until precheck, so they aren't relayed.
+    void precheck();
+    //parts of precheck for batches: VerifyPipeline hashes headers of many shares by one pow_hash_many.
+    void precheck_header(); //timestamp, target: before PoW, so bad share isn't hashed
+    PackStream packed_header();
+    void check_pow(const uint256 &_pow_hash);
+    //set by caller of precheck (VerifyPipeline commits them in node context).
+    bool prechecked = false;
+    std::optional<std::string> precheck_error;
+
     virtual bool check(shared_ptr<ShareTracker> tracker /*, TODO: other_txs = None???*/);
 
     static PackStream get_ref_hash(shared_ptr<c2pool::Network> _net, ShareInfo _share_info, MerkleLink _ref_merkle_link)
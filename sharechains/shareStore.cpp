@@ -13,7 +13,7 @@ namespace c2pool::shares
 {
 
     //
-    ShareStore::ShareStore(const std::string /*TODO: boost::filesystem*/ filepath/*, net, share_cb, verifiedHashCB*/) : Database(filepath)
+    ShareStore::ShareStore(const std::string /*TODO: boost::filesystem*/ filepath/*, net, share_cb, verifiedHashCB*/) : Database(filepath), pow_cache_path(filepath + ".pow")
     {
 
         // self.net = net
@@ -63,4 +63,14 @@ namespace c2pool::shares
         //TODO: uint256 to String
         Remove(share_hash.ToString());
     }
+
+    bool ShareStore::save_pow_cache(coind::PowCache &cache)
+    {
+        return cache.save(pow_cache_path);
+    }
+
+    size_t ShareStore::load_pow_cache(coind::PowCache &cache)
+    {
+        return cache.load(pow_cache_path);
+    }
 } // namespace c2pool::shares
\ No newline at end of file
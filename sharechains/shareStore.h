@@ -1,6 +1,7 @@
 #pragma once
 #include <libdevcore/db.h>
 #include <btclibs/uint256.h>
+#include <networks/pow_cache.h>
 
 #include <memory>
 using std::shared_ptr;
@@ -25,6 +26,13 @@ namespace c2pool::shares
         void add_share(shared_ptr<BaseShare> share);
         void forget_share(uint256 share_hash);
 
+        //PoW of known headers next to the store: restart doesn't recompute scrypt for stored shares.
+        bool save_pow_cache(coind::PowCache &cache);
+        size_t load_pow_cache(coind::PowCache &cache);
+
+    private:
+        std::string pow_cache_path;
+
     //----------------
 
     // public:
@@ -185,9 +185,10 @@ public:
     }
 };
 
+//80 bytes block header; packed for every PoW check.
 struct BlockHeaderType_stream
 {
-    VarIntType version;
+    IntType(32) version;
     PossibleNoneType<IntType(256) > previous_block;
     IntType(256) merkle_root;
     IntType(32) timestamp;
@@ -218,16 +219,27 @@ struct BlockHeaderType_stream
         result.nonce = nonce.value;
     }
 
+    typedef FixedLayout<IntType(32), PossibleNoneType<IntType(256)>, IntType(256), IntType(32), FloatingIntegerType, IntType(32)> layout;
+    static constexpr size_t fixed_size = layout::size;
+
+    void write_fixed(unsigned char *out) const
+    {
+        layout::write(out, version, previous_block, merkle_root, timestamp, bits, nonce);
+    }
+
+    void read_fixed(const unsigned char *in)
+    {
+        layout::read(in, version, previous_block, merkle_root, timestamp, bits, nonce);
+    }
+
     PackStream &write(PackStream &stream)
     {
-        stream << version << previous_block << merkle_root << timestamp << bits << nonce;
-        return stream;
+        return stream.write_fixed(*this);
     }
 
     PackStream &read(PackStream &stream)
     {
-        stream >> version >> previous_block >> merkle_root >> timestamp >> bits >> nonce;
-        return stream;
+        return stream.read_fixed(*this);
     }
 };
 
@@ -619,16 +631,21 @@ struct RefType
         //TODO: *share_info = _share_info;
     }
 
+    //share_info is versioned (ShareInfoVer_stream): serialized by its own write/read.
     PackStream &write(PackStream &stream)
     {
-        stream << identifier << share_info;
-        return stream;
+        if (!share_info)
+            throw std::runtime_error("RefType without share_info");
+        stream << identifier;
+        return share_info->write(stream);
     }
 
     PackStream &read(PackStream &stream)
     {
-        stream >> identifier >> share_info;
-        return stream;
+        if (!share_info)
+            throw std::runtime_error("RefType without share_info");
+        stream >> identifier;
+        return share_info->read(stream);
     }
 };
 
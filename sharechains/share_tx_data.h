@@ -0,0 +1,321 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <mutex>
+#include <array>
+#include <atomic>
+#include <stdexcept>
+#include <cstdint>
+#include <btclibs/uint256.h>
+#include "hash_index.h"
+
+namespace c2pool::shares
+{
+    //Interned tx hashes of all shares in process: shares of a window repeat the same hashes,
+    //so share keeps 32-bit ids. Entry released (id reused), when last share with it removed.
+    //Hashes are in append-only chunks, so get() is lock-free: slot of id isn't changed while caller holds the id;
+    //intern/retain/release take the lock once per share.
+    class TxHashTable
+    {
+    private:
+        static constexpr uint32_t chunk_bits = 12;
+        static constexpr uint32_t chunk_size = 1 << chunk_bits;
+        static constexpr uint32_t max_chunks = 1 << 14; //64M ids
+
+        std::mutex mutex;
+        HashIndex<uint32_t> ids; //hash -> id
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> free_ids;
+        std::array<std::atomic<uint256 *>, max_chunks> chunks{};
+
+        uint32_t intern_locked(const uint256 &hash)
+        {
+            auto pos = ids.find_index(hash);
+            if (pos != HashIndex<uint32_t>::npos)
+            {
+                auto id = ids.get(pos).second;
+                counts[id] += 1;
+                return id;
+            }
+
+            uint32_t id;
+            if (!free_ids.empty())
+            {
+                id = free_ids.back();
+                free_ids.pop_back();
+            }
+            else
+            {
+                id = counts.size();
+                if ((id >> chunk_bits) >= max_chunks)
+                    throw std::length_error("TxHashTable is full");
+                if ((id & (chunk_size - 1)) == 0)
+                    chunks[id >> chunk_bits].store(new uint256[chunk_size], std::memory_order_release);
+                counts.push_back(0);
+            }
+            chunks[id >> chunk_bits].load(std::memory_order_relaxed)[id & (chunk_size - 1)] = hash;
+            ids.insert_or_assign(hash, id);
+            counts[id] = 1;
+            return id;
+        }
+
+    public:
+        static TxHashTable &instance()
+        {
+            static TxHashTable table;
+            return table;
+        }
+
+        ~TxHashTable()
+        {
+            for (auto &chunk : chunks)
+                delete[] chunk.load();
+        }
+
+        void intern(const std::vector<uint256> &hashes, std::vector<uint32_t> &result)
+        {
+            result.reserve(result.size() + hashes.size());
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &hash : hashes)
+                result.push_back(intern_locked(hash));
+        }
+
+        void retain(const std::vector<uint32_t> &_ids)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto id : _ids)
+                counts[id] += 1;
+        }
+
+        void release(const std::vector<uint32_t> &_ids)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto id : _ids)
+            {
+                counts[id] -= 1;
+                if (counts[id] == 0)
+                {
+                    ids.erase(get(id));
+                    free_ids.push_back(id);
+                }
+            }
+        }
+
+        //without lock: id must be held (by ShareTxHashes).
+        const uint256 &get(uint32_t id) const
+        {
+            return chunks[id >> chunk_bits].load(std::memory_order_acquire)[id & (chunk_size - 1)];
+        }
+
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return ids.size();
+        }
+    };
+
+    //new_transaction_hashes of share as ids in TxHashTable.
+    class ShareTxHashes
+    {
+    private:
+        std::vector<uint32_t> ids;
+
+        void release()
+        {
+            if (!ids.empty())
+                TxHashTable::instance().release(ids);
+            ids.clear();
+        }
+
+    public:
+        class const_iterator
+        {
+        private:
+            const ShareTxHashes *_hashes;
+            size_t _pos;
+
+        public:
+            const_iterator(const ShareTxHashes *hashes, size_t pos) : _hashes(hashes), _pos(pos) {}
+
+            uint256 operator*() const
+            {
+                return (*_hashes)[_pos];
+            }
+
+            const_iterator &operator++()
+            {
+                _pos++;
+                return *this;
+            }
+
+            bool operator!=(const const_iterator &other) const
+            {
+                return _pos != other._pos;
+            }
+        };
+
+        ShareTxHashes() {}
+
+        ShareTxHashes(const std::vector<uint256> &hashes)
+        {
+            TxHashTable::instance().intern(hashes, ids);
+        }
+
+        ShareTxHashes(const ShareTxHashes &other) : ids(other.ids)
+        {
+            if (!ids.empty())
+                TxHashTable::instance().retain(ids);
+        }
+
+        ShareTxHashes(ShareTxHashes &&other) noexcept : ids(std::move(other.ids))
+        {
+            other.ids.clear();
+        }
+
+        ShareTxHashes &operator=(ShareTxHashes other)
+        {
+            release();
+            ids.swap(other.ids);
+            return *this;
+        }
+
+        ~ShareTxHashes()
+        {
+            release();
+        }
+
+        size_t size() const
+        {
+            return ids.size();
+        }
+
+        bool empty() const
+        {
+            return ids.empty();
+        }
+
+        const uint256 &operator[](size_t i) const
+        {
+            return TxHashTable::instance().get(ids[i]);
+        }
+
+        uint32_t id(size_t i) const
+        {
+            return ids[i];
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, ids.size());
+        }
+
+        std::vector<uint256> get() const
+        {
+            std::vector<uint256> res;
+            res.reserve(ids.size());
+            for (auto id : ids)
+                res.push_back(TxHashTable::instance().get(id));
+            return res;
+        }
+    };
+
+    //transaction_hash_refs: (share_count, tx_count) pairs, uint16 when all fit, else uint32
+    //(p2pool array.array('H') / array.array('L')).
+    class PackedTxRefs
+    {
+    private:
+        std::vector<uint16_t> refs16;
+        std::vector<uint32_t> refs32; //used, when not empty
+
+    public:
+        class const_iterator
+        {
+        private:
+            const PackedTxRefs *_refs;
+            size_t _pos;
+
+        public:
+            const_iterator(const PackedTxRefs *refs, size_t pos) : _refs(refs), _pos(pos) {}
+
+            std::tuple<int, int> operator*() const
+            {
+                return (*_refs)[_pos];
+            }
+
+            const_iterator &operator++()
+            {
+                _pos++;
+                return *this;
+            }
+
+            bool operator!=(const const_iterator &other) const
+            {
+                return _pos != other._pos;
+            }
+        };
+
+        PackedTxRefs() {}
+
+        PackedTxRefs(const std::vector<std::tuple<int, int>> &refs)
+        {
+            bool fits16 = true;
+            for (auto &ref : refs)
+            {
+                if (std::get<0>(ref) >= (1 << 16) || std::get<1>(ref) >= (1 << 16))
+                    fits16 = false;
+            }
+
+            if (fits16)
+            {
+                refs16.reserve(refs.size() * 2);
+                for (auto &ref : refs)
+                {
+                    refs16.push_back(std::get<0>(ref));
+                    refs16.push_back(std::get<1>(ref));
+                }
+            }
+            else
+            {
+                refs32.reserve(refs.size() * 2);
+                for (auto &ref : refs)
+                {
+                    refs32.push_back(std::get<0>(ref));
+                    refs32.push_back(std::get<1>(ref));
+                }
+            }
+        }
+
+        size_t size() const
+        {
+            return refs32.empty() ? refs16.size() / 2 : refs32.size() / 2;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        std::tuple<int, int> operator[](size_t i) const
+        {
+            if (refs32.empty())
+                return std::make_tuple((int) refs16[2 * i], (int) refs16[2 * i + 1]);
+            return std::make_tuple((int) refs32[2 * i], (int) refs32[2 * i + 1]);
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, size());
+        }
+    };
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <btclibs/uint256.h>
+#include "share.h"
+#include "hash_index.h"
+#include "prefsum_share.h"
+
+namespace c2pool::shares
+{
+    //tx_hash_to_this of generate_share_transactions: tx hash -> (1 + distance from head, index in new_transaction_hashes)
+    //for the last window_size shares of the chain with head.
+    //When head moves forward, only new shares are added and shares out of window expired.
+    class ShareTxIndex
+    {
+    public:
+        static constexpr int32_t window_size = 100;
+
+    private:
+        PrefsumShare &tracker;
+
+        uint256 head;
+        int64_t head_seq = 0;
+        std::deque<std::tuple<uint256, int64_t>> window; //(share hash, seq), oldest first
+        HashIndex<std::pair<int64_t, int32_t>> txs;     //tx hash -> (seq of the newest share with tx, index)
+
+        void push(const uint256 &share_hash)
+        {
+            auto seq = ++head_seq;
+            window.emplace_back(share_hash, seq);
+            auto &tx_hashes = tracker.items.at(share_hash)->new_transaction_hashes;
+            for (int32_t j = 0; j < (int32_t) tx_hashes.size(); j++)
+            {
+                auto tx = txs.find(tx_hashes[j]);
+                if (tx != txs.end() && tx->second.first == seq)
+                    continue;
+                txs.insert_or_assign(tx_hashes[j], std::make_pair(seq, j));
+            }
+        }
+
+        void pop()
+        {
+            uint256 share_hash;
+            int64_t seq;
+            std::tie(share_hash, seq) = window.front();
+            window.pop_front();
+
+            auto share = tracker.items.find(share_hash);
+            if (share == tracker.items.end())
+            {
+                //share removed from tracker: expire by full scan.
+                for (auto tx = txs.begin(); tx != txs.end(); tx++)
+                {
+                    if (tx->second.first == seq)
+                        txs.erase(tx);
+                }
+                return;
+            }
+            for (auto tx_hash : share->second->new_transaction_hashes)
+            {
+                auto tx = txs.find(tx_hash);
+                //newer share with same tx keeps it.
+                if (tx != txs.end() && tx->second.first == seq)
+                    txs.erase(tx);
+            }
+        }
+
+        void clear()
+        {
+            head.SetNull();
+            window.clear();
+            txs.clear();
+        }
+
+    public:
+        ShareTxIndex(PrefsumShare &_tracker) : tracker(_tracker)
+        {
+            head.SetNull();
+        }
+
+        //move window to chain with new_head; O(new shares * txs) when new_head is descendant of head.
+        void set_head(uint256 new_head)
+        {
+            if (new_head == head)
+                return;
+            if (new_head.IsNull() || !tracker.exists(new_head))
+            {
+                clear();
+                return;
+            }
+
+            auto new_height = tracker.get_height(new_head);
+            std::vector<uint256> path;
+            int32_t dist = -1;
+            if (!head.IsNull() && tracker.exists(head))
+                dist = new_height - tracker.get_height(head);
+            if (dist > 0 && dist <= window_size && tracker.get_nth_parent_hash(new_head, dist) == head)
+            {
+                path.reserve(dist);
+            }
+            else
+            {
+                //other chain: rebuild.
+                clear();
+                dist = std::min(new_height, window_size);
+            }
+
+            auto get_chain = tracker.get_chain(new_head, dist);
+            uint256 hash;
+            while (get_chain(hash))
+            {
+                path.push_back(hash);
+            }
+            for (auto share_hash = path.rbegin(); share_hash != path.rend(); share_hash++)
+            {
+                push(*share_hash);
+            }
+            head = new_head;
+
+            while ((int32_t) window.size() > std::min(new_height, window_size))
+            {
+                pop();
+            }
+        }
+
+        //(1 + distance from head, index in share), false if tx not in the window.
+        bool get(const uint256 &tx_hash, std::tuple<int, int> &res)
+        {
+            auto tx = txs.find(tx_hash);
+            if (tx == txs.end())
+                return false;
+            res = std::make_tuple((int) (head_seq - tx->second.first + 1), tx->second.second);
+            return true;
+        }
+
+        size_t size() const
+        {
+            return txs.size();
+        }
+    };
+}
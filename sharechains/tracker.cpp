@@ -7,9 +7,12 @@ using namespace c2pool::shares;
 #include <btclibs/uint256.h>
 #include <libdevcore/logger.h>
 #include <libdevcore/common.h>
+#include <libdevcore/random.h>
 #include <libcoind/data.h>
 
 #include <map>
+#include <set>
+#include <vector>
 #include <queue>
 #include <memory>
 #include <cmath>
@@ -24,7 +27,7 @@ using std::shared_ptr;
 
 #include <boost/format.hpp>
 
-ShareTracker::ShareTracker(shared_ptr<c2pool::Network> _net) : verified(shares), net(_net), parent_net(_net->parent)
+ShareTracker::ShareTracker(shared_ptr<c2pool::Network> _net) : verified(shares), get_cumulative_weights(shares), tx_hash_to_this(shares), verifier(std::make_shared<VerifyPipeline>()), net(_net), parent_net(_net->parent)
 {
 
 }
@@ -53,12 +56,35 @@ void ShareTracker::add(shared_ptr<BaseShare> share)
 	if (!shares.exists(share->hash))
 	{
 		shares.add(share);
+		added.happened({share});
 	} else
 	{
 		LOG_WARNING << share->hash.ToString() << " item already present"; //TODO: for what???
 	}
 }
 
+void ShareTracker::add_many(std::vector<shared_ptr<BaseShare>> _shares)
+{
+	std::vector<shared_ptr<BaseShare>> new_shares;
+	new_shares.reserve(_shares.size());
+	std::set<uint256> batch;
+	for (auto &share : _shares)
+	{
+		if (!share || shares.exists(share->hash) || !batch.insert(share->hash).second)
+			continue;
+		new_shares.push_back(share);
+	}
+	if (new_shares.size() != _shares.size())
+	{
+		LOG_DEBUG << "ShareTracker::add_many: " << _shares.size() - new_shares.size() << " shares already present";
+	}
+	if (new_shares.empty())
+		return;
+
+	shares.add_many(new_shares);
+	added.happened(new_shares);
+}
+
 bool ShareTracker::attempt_verify(shared_ptr<BaseShare> share)
 {
 	if (verified.exists(share->hash))
@@ -66,13 +92,21 @@ bool ShareTracker::attempt_verify(shared_ptr<BaseShare> share)
 		return true;
 	}
 
+	//like p2pool: any error of checks means bad share.
 	try
 	{
+		if (share->precheck_error)
+			throw std::invalid_argument(share->precheck_error.value());
+		if (!share->prechecked)
+		{
+			share->precheck();
+			share->prechecked = true;
+		}
 		share->check(shared_from_this());
 	}
-	catch (const std::invalid_argument &e)
+	catch (const std::exception &e)
 	{
-		LOG_WARNING << e.what() << '\n';
+		LOG_WARNING << "Share check failed: " << e.what();
 		return false;
 	}
 
@@ -80,8 +114,210 @@ bool ShareTracker::attempt_verify(shared_ptr<BaseShare> share)
 	return true;
 }
 
-TrackerThinkResult ShareTracker::think()
+std::vector<uint256> ShareTracker::attempt_verify_many(std::vector<shared_ptr<BaseShare>> _shares)
+{
+	std::vector<uint256> bads;
+	std::set<uint256> batch;
+	for (auto &share : _shares)
+	{
+		batch.insert(share->hash);
+	}
+	//parent before child
+	std::sort(_shares.begin(), _shares.end(), [&](const shared_ptr<BaseShare> &a, const shared_ptr<BaseShare> &b)
+	{
+		return shares.get_height(a->hash) < shares.get_height(b->hash);
+	});
+
+	verifier->request(_shares);
+	for (auto &share : _shares)
+	{
+		if (!verifier->ready(share) || (batch.count(share->previous_hash) && !verified.exists(share->previous_hash)))
+			continue;
+		if (!attempt_verify(share))
+			bads.push_back(share->hash);
+	}
+	return bads;
+}
+
+TrackerThinkResult ShareTracker::think(boost::function<int32_t(uint256)> block_rel_height_func, uint256 previous_block)
 {
+	std::vector<uint256> bads;
+	//peer_addr, hash, timestamp, target
+	std::vector<std::tuple<c2pool::libnet::addr, uint256, int32_t, uint256>> desired;
+	std::set<std::tuple<std::string, std::string>> bad_peer_addresses;
+
+	auto make_desired = [&](PrefsumShare &tracker, uint256 reverse_hash, uint256 hash, uint256 head, int32_t head_height)
+	{
+		auto &reverse = tracker.roots[reverse_hash];
+		auto after_last = std::next(reverse.begin(), c2pool::random::RandomInt(0, reverse.size()));
+
+		int32_t max_timestamp = 0;
+		uint256 min_target;
+		auto get_chain = shares.get_chain(head, std::min(head_height, 5));
+		uint256 _hash;
+		while (get_chain(_hash))
+		{
+			auto share = shares.items[_hash];
+			max_timestamp = std::max(max_timestamp, share->timestamp);
+			if (min_target.IsNull() || share->target < min_target)
+				min_target = share->target;
+		}
+		desired.push_back(std::make_tuple(tracker.sum.get(*after_last).second.element->peer_addr, hash, max_timestamp, min_target));
+	};
+
+	//only heads, that changed since last verification
+	std::vector<uint256> unverified_heads;
+	for (auto &head : shares.heads)
+	{
+		if (verified.heads.find(head.first) == verified.heads.end())
+			unverified_heads.push_back(head.first);
+	}
+
+	for (auto head : unverified_heads)
+	{
+		int32_t head_height;
+		uint256 last;
+		std::tie(head_height, last) = shares.get_height_and_last(head);
+
+		auto get_chain = shares.get_chain(head, last.IsNull() ? head_height : std::min(5, std::max(0, head_height - net->CHAIN_LENGTH)));
+		std::vector<shared_ptr<BaseShare>> chain;
+		uint256 hash;
+		while (get_chain(hash))
+		{
+			chain.push_back(shares.items[hash]);
+		}
+		//walk stops at share with precheck in flight: continued, when verifier->prechecked.
+		bool verified_chain = false, waiting = false;
+		verifier->request(chain);
+		for (auto &share : chain)
+		{
+			if (!verifier->ready(share))
+			{
+				waiting = true;
+				break;
+			}
+			if (attempt_verify(share))
+			{
+				verified_chain = true;
+				break;
+			}
+			bads.push_back(share->hash);
+		}
+		if (!verified_chain && !waiting && !last.IsNull())
+			make_desired(shares, last, last, head, head_height);
+	}
+
+	for (auto bad : bads)
+	{
+		if (verified.exists(bad))
+			throw std::runtime_error("think: bad share in verified");
+
+		auto bad_share = shares.items[bad];
+		bad_peer_addresses.insert(bad_share->peer_addr);
+		LOG_DEBUG << "BAD " << bad.ToString();
+		shares.remove(bad);
+	}
+
+	std::vector<uint256> verified_heads;
+	for (auto &head : verified.heads)
+	{
+		verified_heads.push_back(head.first);
+	}
+
+	for (auto head : verified_heads)
+	{
+		int32_t head_height;
+		uint256 last_hash;
+		std::tie(head_height, last_hash) = verified.get_height_and_last(head);
+
+		int32_t last_height = 0;
+		uint256 last_last_hash = last_hash;
+		if (shares.exists(last_hash))
+			std::tie(last_height, last_last_hash) = shares.get_height_and_last(last_hash);
+
+		auto want = std::max(net->CHAIN_LENGTH - head_height, 0);
+		auto can = last_last_hash.IsNull() ? last_height : std::max(last_height - 1 - net->CHAIN_LENGTH, 0);
+		auto get_chain = shares.get_chain(last_hash, std::min(want, can));
+		std::vector<shared_ptr<BaseShare>> chain;
+		uint256 hash;
+		while (get_chain(hash))
+		{
+			chain.push_back(shares.items[hash]);
+		}
+		verifier->request(chain);
+		for (auto &share : chain)
+		{
+			if (!verifier->ready(share) || !attempt_verify(share))
+				break;
+		}
+		if (head_height < net->CHAIN_LENGTH && !last_last_hash.IsNull())
+			make_desired(verified, last_hash, last_last_hash, head, head_height);
+	}
+
+	// decide best tree
+	for (auto it = tail_scores.begin(); it != tail_scores.end();)
+	{
+		if (verified.tails.find(it->first) == verified.tails.end())
+			it = tail_scores.erase(it);
+		else
+			it++;
+	}
+
+	boost::optional<std::tuple<std::tuple<int32_t, uint256>, uint256>> best_tail;
+	for (auto &tail : verified.tails)
+	{
+		auto best_head = verified.get_best_head(tail.first);
+		auto cached = tail_scores.find(tail.first);
+		if (cached == tail_scores.end() || std::get<0>(cached->second) != best_head || std::get<1>(cached->second) != previous_block)
+		{
+			cached = tail_scores.insert_or_assign(tail.first, std::make_tuple(best_head, previous_block, score(best_head, block_rel_height_func))).first;
+		}
+
+		auto decorated_tail = std::make_tuple(std::get<2>(cached->second), tail.first);
+		if (!best_tail.has_value() || best_tail.value() < decorated_tail)
+			best_tail = decorated_tail;
+	}
+
+	// decide best verified head
+	std::vector<std::tuple<std::tuple<arith_uint256, int64_t>, uint256>> decorated_heads;
+	if (best_tail.has_value())
+	{
+		for (auto &head : verified.tails[std::get<1>(best_tail.value())])
+		{
+			auto head_hash = std::get<1>(head);
+			auto parent_hash = verified.get_nth_parent_hash(head_hash, std::min(5, verified.get_height(head_hash)));
+			auto work = verified.exists(parent_hash) ? UintToArith256(verified.get_work(parent_hash)) : arith_uint256();
+			//TODO: -should_punish_reason(previous_block, bits, this, known_txs)[0]
+			decorated_heads.push_back(std::make_tuple(std::make_tuple(work, -(int64_t) shares.items[head_hash]->time_seen), head_hash));
+		}
+		std::sort(decorated_heads.begin(), decorated_heads.end());
+	}
+
+	TrackerThinkResult result;
+	result.best_hash.SetNull();
+	int64_t timestamp_cutoff;
+	if (!decorated_heads.empty())
+	{
+		result.best_hash = std::get<1>(decorated_heads.back());
+		auto best_share = shares.items[result.best_hash];
+		//TODO: punish best_share
+		timestamp_cutoff = std::min((int64_t) c2pool::dev::timestamp(), (int64_t) best_share->timestamp) - 3600;
+	} else
+	{
+		timestamp_cutoff = c2pool::dev::timestamp() - 24 * 60 * 60;
+	}
+
+	for (auto &item : desired)
+	{
+		if (std::get<2>(item) >= timestamp_cutoff)
+			result.desired.push_back(std::make_tuple(std::get<0>(item), std::get<1>(item)));
+	}
+	for (auto &head : decorated_heads)
+	{
+		result.decorated_heads.push_back(std::get<1>(head));
+	}
+	result.bad_peer_addresses = bad_peer_addresses;
+	return result;
 }
 
 uint256 ShareTracker::get_pool_attempts_per_second(uint256 previous_share_hash, int32_t dist, bool min_work)
@@ -10,11 +10,16 @@
 #include "univalue.h"
 #include "shareTypes.h"
 #include "prefsum_share.h"
+#include "weights_skiplist.h"
+#include "share_tx_index.h"
+#include "verify_pipeline.h"
 #include <btclibs/uint256.h>
 #include <btclibs/arith_uint256.h>
 #include <libcoind/data.h>
+#include <libcoind/transaction.h>
 #include <libdevcore/logger.h>
 #include <libdevcore/common.h>
+#include <libdevcore/events.h>
 #include <networks/network.h>
 
 using namespace std;
@@ -51,9 +56,17 @@ class ShareTracker : public enable_shared_from_this<ShareTracker>
 public:
 	PrefsumShare shares;
 	PrefsumVerifiedShare verified;
+	WeightsSkipList get_cumulative_weights;
+	ShareTxIndex tx_hash_to_this; //for chain of last generated share
+
+	Event<std::vector<shared_ptr<BaseShare>>> added; //once for add_many batch
+	shared_ptr<VerifyPipeline> verifier; //prechecks; verifier->prechecked -> think again
 public:
 	shared_ptr<c2pool::Network> net;
 	shared_ptr<coind::ParentNetwork> parent_net;
+private:
+	//tail -> (best head, previous_block, score); score recalculated only when best head or block changed.
+	map<uint256, std::tuple<uint256, uint256, std::tuple<int32_t, uint256>>> tail_scores;
 public:
 	ShareTracker(shared_ptr<c2pool::Network> _net);
 
@@ -61,15 +74,19 @@ public:
 
 	void add(shared_ptr<BaseShare> share);
 
+	//shares from message_shares or ShareStore; duplicates skipped.
+	void add_many(std::vector<shared_ptr<BaseShare>> _shares);
+
 	bool attempt_verify(shared_ptr<BaseShare> share);
 
-	TrackerThinkResult think();
+	//verify shares (already added) with prechecks in parallel; parents verified before children,
+	//share with not verified parent from this batch or precheck in flight skipped (think verifies it later). Returns bad shares.
+	std::vector<uint256> attempt_verify_many(std::vector<shared_ptr<BaseShare>> _shares);
 
+	TrackerThinkResult think(boost::function<int32_t(uint256)> block_rel_height_func, uint256 previous_block);
 
-	int32_t get_height_rel_highest(uint256 prev_block_hash)
-	{
-		//TODO:
-	}
+	//block heights changed (lookup finished): scores of all tails are recalculated in next think.
+	void reset_tail_scores() { tail_scores.clear(); }
 
 	uint256 get_pool_attempts_per_second(uint256 previous_share_hash, int32_t dist, bool min_work = false);
 
@@ -79,7 +96,7 @@ public:
 	generate_share_transactions(ShareData share_data, uint256 block_target, int32_t desired_timestamp,
 								uint256 desired_target, MerkleLink ref_merkle_link,
 								vector<tuple<uint256, boost::optional<int32_t>>> desired_other_transaction_hashes_and_fees,
-								map<uint256, UniValue> known_txs = map<uint256, UniValue>(),
+								map<uint256, coind::data::tx_type> known_txs = map<uint256, coind::data::tx_type>(),
 								unsigned long long last_txout_nonce = 0, long long base_subsidy = 0,
 								UniValue other_data = UniValue())
 	{
@@ -125,26 +142,8 @@ public:
 
 		//t1
 
-		auto past_shares_generator = shares.get_chain(previous_share->hash, std::min(height, 100));
-		map<uint256, tuple<int, int>> tx_hash_to_this;
-
-		{
-			uint256 _hash;
-			int32_t i = 0;
-			while (past_shares_generator(_hash))
-			{
-				auto _share = shares.items[_hash];
-				for (int j = 0; j < _share->new_transaction_hashes.size(); j++)
-				{
-					auto tx_hash = _share->new_transaction_hashes[j];
-					if (tx_hash_to_this.find(tx_hash) == tx_hash_to_this.end())
-					{
-						tx_hash_to_this[tx_hash] = std::make_tuple(1 + i, j);
-					}
-				}
-				i += 1;
-			}
-		}
+		//last 100 shares; only new shares added, when best share moves forward.
+		tx_hash_to_this.set_head(share_data.previous_share_hash);
 
 		//t2
 
@@ -158,8 +157,11 @@ public:
 			int32_t this_weight = 0;
 			if (!known_txs.empty())
 			{
-				// this_stripped_size = c2pool::python::PyPackTypes::packed_size("tx_id_type", known_txs[tx_hash]); //TODO:
-				// this_real_size = c2pool::python::PyPackTypes::packed_size("tx_type", known_txs[tx_hash]); //TODO:
+				auto tx = known_txs[tx_hash];
+				coind::data::stream::TxIDType_stream tx_id(tx->version, tx->tx_ins, tx->tx_outs, tx->lock_time);
+				coind::data::stream::TransactionType_stream tx_packed(tx);
+				this_stripped_size = PackStream::packed_size(tx_id);
+				this_real_size = PackStream::packed_size(tx_packed);
 				this_weight = this_real_size + 3 * this_stripped_size;
 			}
 
@@ -174,10 +176,7 @@ public:
 			all_transaction_stripped_size += this_stripped_size;
 			//all_transaction_real_size += this_real_size;
 			all_transaction_weight += this_weight;
-			if (tx_hash_to_this.find(tx_hash) != tx_hash_to_this.end())
-			{
-				_this = tx_hash_to_this[tx_hash];
-			} else
+			if (!tx_hash_to_this.get(tx_hash, _this))
 			{
 				//new_transaction_size += this_real_size;
 				new_transaction_weight += this_weight;
@@ -250,18 +249,22 @@ public:
 			share_data.subsidy = base_subsidy + definite_fees;
 		}
 
-		/*TODO:
-		weights, total_weight, donation_weight = tracker.get_cumulative_weights(previous_share.share_data['previous_share_hash'] if previous_share is not None else None,
-		max(0, min(height, net.REAL_CHAIN_LENGTH) - 1),
-		65535*net.SPREAD*bitcoin_data.target_to_average_attempts(block_target),
-	)
-	*/
-		//TODO: types
-		tuple<int32_t, int32_t, int32_t> cumulative_weights; //TODO: Реализовать get_cumulative_weights
-		int32_t weights = std::get<0>(cumulative_weights);
-		int32_t total_weight = std::get<1>(cumulative_weights);
-		int32_t donation_weight = std::get<2>(cumulative_weights);
-		//TODO: [assert] assert total_weight == sum(weights.itervalues()) + donation_weight, (total_weight, sum(weights.itervalues()) + donation_weight)
+		uint256 weights_start;
+		weights_start.SetNull();
+		if (previous_share != nullptr)
+			weights_start = previous_share->previous_hash;
+		auto cumulative_weights = get_cumulative_weights(weights_start, std::max(0, std::min(height, net->REAL_CHAIN_LENGTH) - 1),
+														 UintToArith256(coind::data::target_to_average_attempts(block_target)) * 65535 * net->SPREAD);
+		auto &weights = cumulative_weights.weights;
+		auto total_weight = cumulative_weights.total_weight;
+		auto donation_weight = cumulative_weights.donation_weight;
+		{
+			arith_uint256 sum_weights = donation_weight;
+			for (auto &weight : weights)
+				sum_weights += weight.second;
+			if (total_weight != sum_weights)
+				throw std::runtime_error("generate_share_transactions: total_weight != sum(weights) + donation_weight");
+		}
 
 		/*TODO:
 		amounts = dict((script, share_data['subsidy']*(199*weight)//(200*total_weight)) for script, weight in weights.iteritems()) # 99.5% goes according to weights prior to this share
@@ -415,7 +418,7 @@ public:
 		return {share_info, gentx, other_transaction_hashes, get_share};
 	}
 
-	std::tuple<int32_t, uint256> score(uint256 share_hash)
+	std::tuple<int32_t, uint256> score(uint256 share_hash, boost::function<int32_t(uint256)> block_rel_height_func)
 	{
 		uint256 score_res;
 		score_res.SetNull();
@@ -435,7 +438,7 @@ public:
 		{
 			auto share = verified.items[hash];
 
-			auto block_height_temp = get_height_rel_highest(share->header.previous_block);
+			auto block_height_temp = block_rel_height_func(share->header.previous_block);
 			if (!block_height.has_value())
 			{
 				block_height = block_height_temp;
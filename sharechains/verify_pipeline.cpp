@@ -0,0 +1,130 @@
+#include "verify_pipeline.h"
+#include "share.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <boost/asio/post.hpp>
+
+namespace c2pool::shares
+{
+    void VerifyPipeline::start(std::shared_ptr<boost::asio::thread_pool> _pool, std::shared_ptr<boost::asio::io_context> _context, size_t threads, size_t _lanes)
+    {
+        pool = std::move(_pool);
+        context = std::move(_context);
+        lanes = std::max<size_t>(1, _lanes);
+        window = 4 * std::max<size_t>(1, threads) * lanes;
+    }
+
+    bool VerifyPipeline::ready(const std::shared_ptr<BaseShare> &share) const
+    {
+        return !pool || share->prechecked || share->precheck_error;
+    }
+
+    void VerifyPipeline::request(const std::vector<std::shared_ptr<BaseShare>> &shares)
+    {
+        if (!pool)
+            return;
+        std::vector<std::shared_ptr<BaseShare>> batch;
+        for (auto &share : shares)
+        {
+            if (pending.size() + batch.size() >= window)
+                break;
+            if (ready(share) || pending.count(share->hash))
+                continue;
+            batch.push_back(share);
+            if (batch.size() == lanes)
+            {
+                submit(std::move(batch));
+                batch.clear();
+            }
+        }
+        if (!batch.empty())
+            submit(std::move(batch));
+    }
+
+    //like p2pool: any exception of precheck means bad share.
+    template <typename F>
+    static std::optional<std::string> precheck_error(F f)
+    {
+        try
+        {
+            f();
+        }
+        catch (const std::exception &e)
+        {
+            return std::string(e.what());
+        }
+        catch (...)
+        {
+            return std::string("unknown precheck error");
+        }
+        return std::nullopt;
+    }
+
+    void VerifyPipeline::submit(std::vector<std::shared_ptr<BaseShare>> batch)
+    {
+        for (auto &share : batch)
+            pending.insert(share->hash);
+        boost::asio::post(*pool, [self = shared_from_this(), batch]()
+        {
+            std::vector<std::optional<std::string>> errors(batch.size());
+            //shares with good timestamp and target: their headers are hashed together.
+            std::vector<size_t> hashed;
+            std::vector<PackStream> headers;
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                errors[i] = precheck_error([&]()
+                                           {
+                                               batch[i]->precheck_header();
+                                               headers.push_back(batch[i]->packed_header());
+                                           });
+                if (!errors[i])
+                    hashed.push_back(i);
+            }
+
+            std::vector<uint256> pow_hashes;
+            if (!headers.empty())
+            {
+                auto error = precheck_error([&]()
+                                            { pow_hashes = batch[hashed[0]]->net->parent->pow_hash_many(headers); });
+                if (error)
+                {
+                    for (auto i : hashed)
+                        errors[i] = error;
+                    hashed.clear();
+                }
+            }
+            for (size_t j = 0; j < hashed.size(); j++)
+            {
+                auto i = hashed[j];
+                errors[i] = precheck_error([&]()
+                                           { batch[i]->check_pow(pow_hashes[j]); });
+            }
+
+            boost::asio::post(*self->context, [self, batch, errors]()
+            {
+                for (size_t i = 0; i < batch.size(); i++)
+                    self->commit(batch[i], errors[i]);
+            });
+        });
+    }
+
+    void VerifyPipeline::commit(std::shared_ptr<BaseShare> share, std::optional<std::string> error)
+    {
+        pending.erase(share->hash);
+        if (error)
+            share->precheck_error = error;
+        else
+            share->prechecked = true;
+
+        //results already queued in context are committed before it: one event for them.
+        if (notify_posted)
+            return;
+        notify_posted = true;
+        boost::asio::post(*context, [self = shared_from_this()]()
+        {
+            self->notify_posted = false;
+            self->prechecked.happened();
+        });
+    }
+}
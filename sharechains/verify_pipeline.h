@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <set>
+#include <string>
+#include <optional>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <btclibs/uint256.h>
+#include <libdevcore/events.h>
+
+class BaseShare;
+
+namespace c2pool::shares
+{
+    //Runs BaseShare::precheck (scrypt PoW is the most of verification time) in compute pool of NodeManager:
+    //one task prechecks up to lanes shares, their headers are hashed by one pow_hash_many.
+    //Node thread doesn't wait for workers: results are committed to shares in node context and prechecked happens,
+    //so tracker walks chains again. Without pool (tests, tools) attempt_verify prechecks share inline.
+    class VerifyPipeline : public std::enable_shared_from_this<VerifyPipeline>
+    {
+    private:
+        std::shared_ptr<boost::asio::thread_pool> pool;
+        std::shared_ptr<boost::asio::io_context> context;
+        size_t window = 0; //max prechecks in flight, so chains already verified don't waste much work
+        size_t lanes = 1; //shares in one task
+        std::set<uint256> pending; //shares in pool; node context only
+        bool notify_posted = false;
+
+        void submit(std::vector<std::shared_ptr<BaseShare>> batch);
+
+        void commit(std::shared_ptr<BaseShare> share, std::optional<std::string> error);
+
+    public:
+        //once per batch of results committed in one turn of node context.
+        Event<> prechecked;
+
+        //prechecks in pool, results committed in context (node thread); threads of pool and lanes (ParentNetwork::pow_lanes) for window size.
+        void start(std::shared_ptr<boost::asio::thread_pool> _pool, std::shared_ptr<boost::asio::io_context> _context, size_t threads, size_t _lanes = 1);
+
+        //share->prechecked or share->precheck_error set, or no pool: attempt_verify doesn't wait.
+        bool ready(const std::shared_ptr<BaseShare> &share) const;
+
+        //submit prechecks of shares in given order (first ones are verified first) by batches of lanes, while window isn't full.
+        void request(const std::vector<std::shared_ptr<BaseShare>> &shares);
+    };
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <btclibs/uint256.h>
+#include <btclibs/arith_uint256.h>
+#include <libcoind/data.h>
+#include "share.h"
+#include "hash_index.h"
+#include "prefsum_share.h"
+
+namespace c2pool::shares
+{
+    struct CumulativeWeights
+    {
+        std::map<uint160, arith_uint256> weights; //pubkey_hash -> weight
+        arith_uint256 total_weight;
+        arith_uint256 donation_weight;
+    };
+
+    //weights of shares in span of the skip list.
+    class weights_delta
+    {
+    public:
+        int32_t share_count = 0;
+        std::map<uint160, arith_uint256> weights;
+        arith_uint256 total_weight;
+        arith_uint256 total_donation_weight;
+
+    public:
+        weights_delta() {}
+        weights_delta(const shared_ptr<BaseShare> &share)
+        {
+            auto att = UintToArith256(coind::data::target_to_average_attempts(share->target));
+            share_count = 1;
+            weights[share->pubkey_hash] = att * (65535 - share->donation);
+            total_weight = att * 65535;
+            total_donation_weight = att * share->donation;
+        }
+
+        weights_delta &operator+=(const weights_delta &delta)
+        {
+            share_count += delta.share_count;
+            for (auto &weight : delta.weights)
+            {
+                weights[weight.first] += weight.second;
+            }
+            total_weight += delta.total_weight;
+            total_donation_weight += delta.total_donation_weight;
+            return *this;
+        }
+    };
+
+    //p2pool WeightsSkipList (doc/python_tests/WeightsSkipListTest.py): every share has geometric number of levels,
+    //level i — jump to the nearest ancestor with more than i levels + weights of shares before it.
+    //Levels are cached by share hash: ancestors are fixed by hashes, so cached spans never change.
+    class WeightsSkipList
+    {
+    private:
+        struct skip_node
+        {
+            int32_t levels;
+            std::vector<std::pair<uint256, weights_delta>> skips; //only levels, that reached existing ancestor
+        };
+
+        PrefsumShare &tracker;
+        HashIndex<skip_node> nodes;
+
+        //geometric(0.5) from bits of hash: same levels for share on every node.
+        static const int32_t max_levels = 32;
+
+        static int32_t levels_of(const uint256 &hash)
+        {
+            auto bits = hash.GetUint64(0);
+            int32_t levels = 1;
+            while ((bits & 1) && levels < max_levels)
+            {
+                levels += 1;
+                bits >>= 1;
+            }
+            return levels;
+        }
+
+        //node of existing share with first min(levels, node levels) levels, if ancestors for them exist.
+        skip_node &get_node(const uint256 &hash, int32_t levels)
+        {
+            auto pos = nodes.find_index(hash);
+            if (pos == HashIndex<skip_node>::npos)
+            {
+                auto share = tracker.items.at(hash);
+                skip_node node;
+                node.levels = levels_of(hash);
+                node.skips.emplace_back(share->previous_hash, weights_delta(share));
+                pos = nodes.insert_or_assign(hash, std::move(node)).first.index();
+            }
+
+            //nodes slab can grow in recursion: access node by index only.
+            levels = std::min(levels, nodes.get(pos).second.levels);
+            while ((int32_t) nodes.get(pos).second.skips.size() < levels)
+            {
+                auto level = (int32_t) nodes.get(pos).second.skips.size();
+                auto skip = nodes.get(pos).second.skips.back();
+                while (tracker.exists(skip.first) && levels_of(skip.first) <= level)
+                {
+                    auto &next = get_node(skip.first, level);
+                    if ((int32_t) next.skips.size() < level)
+                        return nodes.get(pos).second;
+                    skip.second += next.skips[level - 1].second;
+                    skip.first = next.skips[level - 1].first;
+                }
+                if (!tracker.exists(skip.first))
+                    break;
+                nodes.get(pos).second.skips.push_back(std::move(skip));
+            }
+            return nodes.get(pos).second;
+        }
+
+    public:
+        WeightsSkipList(PrefsumShare &_tracker) : tracker(_tracker)
+        {
+            tracker.share_removed.subscribe([this](uint256 hash)
+                                            { forget_item(hash); });
+        }
+
+        void forget_item(const uint256 &hash)
+        {
+            nodes.erase(hash);
+        }
+
+        //cached skip nodes.
+        size_t size() const
+        {
+            return nodes.size();
+        }
+
+        //weights of up to max_shares shares from start, capped at desired_weight; the last share counts partially.
+        CumulativeWeights operator()(uint256 start, int32_t max_shares, arith_uint256 desired_weight)
+        {
+            if (desired_weight / 65535 * 65535 != desired_weight)
+                throw std::invalid_argument("get_cumulative_weights: desired_weight % 65535 != 0");
+
+            CumulativeWeights res;
+            if (!tracker.exists(start))
+                return res;
+            //cached spans can cross removed tail shares.
+            max_shares = std::min(max_shares, tracker.get_height(start));
+
+            int32_t share_count = 0;
+            auto pos = start;
+            while (share_count < max_shares && res.total_weight < desired_weight)
+            {
+                auto &node = get_node(pos, max_levels);
+                for (auto skip = node.skips.rbegin(); skip != node.skips.rend(); skip++)
+                {
+                    auto &delta = skip->second;
+                    if (share_count + delta.share_count > max_shares)
+                        continue;
+
+                    if (res.total_weight + delta.total_weight > desired_weight)
+                    {
+                        if (delta.share_count != 1)
+                            continue;
+                        //only part of this share.
+                        auto part = (desired_weight - res.total_weight) / 65535;
+                        auto share_weight = delta.total_weight / 65535;
+                        for (auto &weight : delta.weights)
+                        {
+                            res.weights[weight.first] += part * weight.second / share_weight;
+                        }
+                        res.donation_weight += part * delta.total_donation_weight / share_weight;
+                        res.total_weight = desired_weight;
+                        share_count += 1;
+                        break;
+                    }
+
+                    for (auto &weight : delta.weights)
+                    {
+                        res.weights[weight.first] += weight.second;
+                    }
+                    res.total_weight += delta.total_weight;
+                    res.donation_weight += delta.total_donation_weight;
+                    share_count += delta.share_count;
+                    pos = skip->first;
+                    break;
+                }
+            }
+            return res;
+        }
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+
+//Tests compare new implementations with the previous ones on small inputs.
+//With C2POOL_BENCH set they run on big inputs and print timings of both.
+inline bool bench_enabled()
+{
+    static const bool enabled = std::getenv("C2POOL_BENCH") != nullptr;
+    return enabled;
+}
+
+//input size: small for unit tests, large with C2POOL_BENCH.
+template <typename T>
+T bench_size(T small, T large)
+{
+    return bench_enabled() ? large : small;
+}
+
+//wall time of f() in ms.
+template <typename F>
+double measure_ms(F f)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+//runs previous_f, then new_f; timings printed only with C2POOL_BENCH.
+template <typename PrevF, typename NewF>
+void compare_ms(const std::string &what, PrevF previous_f, NewF new_f)
+{
+    auto previous_ms = measure_ms(previous_f);
+    auto new_ms = measure_ms(new_f);
+    if (bench_enabled())
+        std::cout << what << ": previous = " << previous_ms << " ms, new = " << new_ms << " ms" << std::endl;
+}
@@ -3,10 +3,19 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstdio>
 
 #include <btclibs/uint256.h>
 #include <btclibs/arith_uint256.h>
+#include <btclibs/span.h>
+#include <btclibs/util/strencodings.h>
+#include <libdevcore/stream.h>
+#include <libdevcore/stream_types.h>
 #include <libcoind/data.h>
+#include <networks/network.h>
+
+#include "../bench.h"
 
 using namespace std;
 
@@ -25,8 +34,8 @@ TEST(BitcoindDataTest, target_to_averate_attempts_test){
     auto second = CreateUINT256("1");
     uint256 second_res = coind::data::target_to_average_attempts(second);
     cout << second_res.GetHex() << endl;
-    //Note: in Python: '0x8000000000000000000000000000000000000000000000000000000000000000'
-    ASSERT_EQ(second_res.GetHex(), "7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    //in Python: 2**256 // 2
+    ASSERT_EQ(second_res.GetHex(), "8000000000000000000000000000000000000000000000000000000000000000");
 
     auto third = CreateUINT256("100000000000000000000000000000000");
     uint256 third_res = coind::data::target_to_average_attempts(third);
@@ -36,7 +45,7 @@ TEST(BitcoindDataTest, target_to_averate_attempts_test){
     auto fourth = CreateUINT256("ffffffffffffffffffffffffffffffff");
     uint256 fourth_res = coind::data::target_to_average_attempts(fourth);
     cout << fourth_res.GetHex() << endl;
-    ASSERT_EQ(fourth_res.GetHex(), "00000000000000000000000000000000ffffffffffffffffffffffffffffffff");
+    ASSERT_EQ(fourth_res.GetHex(), "0000000000000000000000000000000100000000000000000000000000000000");
 }
 
 TEST(BitcoindDataTest, average_attempts_to_target_test){
@@ -48,8 +57,8 @@ TEST(BitcoindDataTest, average_attempts_to_target_test){
     auto second = CreateUINT256("100000000000000000000000000000000");
     uint256 second_res = coind::data::target_to_average_attempts(second);
     cout << second_res.GetHex() << endl;
-    //Note: in Python: '0x8000000000000000000000000000000000000000000000000000000000000000'
-    ASSERT_EQ(second_res.GetHex(), "0000000000000000000000000000000100000000000000000000000000000000");
+    //in Python: 2**256 // (2**128 + 1)
+    ASSERT_EQ(second_res.GetHex(), "00000000000000000000000000000000ffffffffffffffffffffffffffffffff");
 
     auto third = CreateUINT256("100000000000000000000000000000000");
     uint256 third_res = coind::data::target_to_average_attempts(third);
@@ -59,5 +68,304 @@ TEST(BitcoindDataTest, average_attempts_to_target_test){
     auto fourth = CreateUINT256("ffffffffffffffffffffffffffffffff");
     uint256 fourth_res = coind::data::target_to_average_attempts(fourth);
     cout << fourth_res.GetHex() << endl;
-    ASSERT_EQ(fourth_res.GetHex(), "00000000000000000000000000000000ffffffffffffffffffffffffffffffff");
-}
\ No newline at end of file
+    ASSERT_EQ(fourth_res.GetHex(), "0000000000000000000000000000000100000000000000000000000000000000");
+}
+
+static vector<uint256> make_leaf_hashes(int32_t count)
+{
+    vector<uint256> hashes;
+    for (int32_t i = 0; i < count; i++)
+    {
+        hashes.push_back(coind::data::hash256(ArithToUint256(arith_uint256(i + 1))));
+    }
+    return hashes;
+}
+
+//p2pool merkle_hash: one hash256 of packed MerkleRecordType per pair.
+static uint256 pairwise_merkle_hash(vector<uint256> hash_list)
+{
+    if (hash_list.empty())
+        return uint256();
+    while (hash_list.size() > 1)
+    {
+        vector<uint256> next;
+        for (int i = 0; i < hash_list.size(); i += 2)
+        {
+            coind::data::MerkleRecordType rec{hash_list[i], i + 1 < hash_list.size() ? hash_list[i + 1] : hash_list[i]};
+            PackStream stream;
+            stream << rec;
+            next.push_back(coind::data::hash256(stream));
+        }
+        hash_list = next;
+    }
+    return hash_list[0];
+}
+
+TEST(BitcoindDataTest, MerkleHashBatchedVsPairwise)
+{
+    for (auto count : {1, 2, 3, 7, bench_size(100, 20000)})
+    {
+        auto hashes = make_leaf_hashes(count);
+
+        uint256 pairwise_root, root;
+        compare_ms("merkle_hash of " + to_string(count) + " leaves, pairwise vs batched",
+                   [&]()
+                   { pairwise_root = pairwise_merkle_hash(hashes); },
+                   [&]()
+                   { root = coind::data::merkle_hash(hashes); });
+        ASSERT_EQ(root, pairwise_root);
+    }
+}
+
+TEST(BitcoindDataTest, CalculateMerkleLink)
+{
+    for (auto count : {2, 7, 100})
+    {
+        auto hashes = make_leaf_hashes(count);
+        auto root = coind::data::merkle_hash(hashes);
+
+        auto link = coind::data::calculate_merkle_link(hashes, 0);
+        ASSERT_EQ(coind::data::check_merkle_link(hashes[0], link), root);
+
+        //gentx hash is unknown, when link is calculated.
+        auto hashes_without_gentx = hashes;
+        hashes_without_gentx[0].SetNull();
+        ASSERT_EQ(std::get<0>(coind::data::calculate_merkle_link(hashes_without_gentx, 0)), std::get<0>(link));
+
+        auto last = count - 1;
+        ASSERT_EQ(coind::data::check_merkle_link(hashes[last], coind::data::calculate_merkle_link(hashes, last)), root);
+    }
+}
+
+//80-byte header with nonce at the end.
+static vector<unsigned char> make_block_header(uint32_t nonce)
+{
+    vector<unsigned char> header(coind::data::HeaderHasher::header_size);
+    for (size_t i = 0; i < header.size(); i++)
+    {
+        header[i] = i * 7 + 1;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        header[76 + i] = (nonce >> (8 * i)) & 0xff;
+    }
+    return header;
+}
+
+TEST(BitcoindDataTest, HeaderHasherMatchesHash256)
+{
+    coind::data::HeaderHasher hasher;
+    for (uint32_t nonce = 0; nonce < 16; nonce++)
+    {
+        auto header = make_block_header(nonce);
+        ASSERT_EQ(hasher(Span<const unsigned char>(header)), coind::data::hash256(Span<const unsigned char>(header)));
+    }
+
+    //other prefix: midstate recalculated.
+    auto header = make_block_header(1);
+    header[4] ^= 0xff;
+    ASSERT_EQ(hasher(Span<const unsigned char>(header)), coind::data::hash256(Span<const unsigned char>(header)));
+
+    PackStream packed_header(header);
+    ASSERT_EQ(hasher(packed_header), coind::data::hash256(Span<const unsigned char>(header)));
+
+    ASSERT_THROW(hasher(Span<const unsigned char>(header.data(), 79)), std::invalid_argument);
+}
+
+TEST(BitcoindDataTest, HeaderHasherMidstateVsFullHash)
+{
+    const uint32_t count = bench_size(1000, 200000);
+    auto header = make_block_header(0);
+
+    coind::data::HeaderHasher hasher;
+    uint256 full_res, midstate_res;
+    compare_ms(to_string(count) + " headers, hash256 vs HeaderHasher", [&]()
+               {
+                   for (uint32_t nonce = 0; nonce < count; nonce++)
+                   {
+                       header[76] = nonce & 0xff;
+                       header[77] = (nonce >> 8) & 0xff;
+                       header[78] = (nonce >> 16) & 0xff;
+                       full_res = coind::data::hash256(Span<const unsigned char>(header));
+                   }
+               },
+               [&]()
+               {
+                   for (uint32_t nonce = 0; nonce < count; nonce++)
+                   {
+                       header[76] = nonce & 0xff;
+                       header[77] = (nonce >> 8) & 0xff;
+                       header[78] = (nonce >> 16) & 0xff;
+                       midstate_res = hasher(Span<const unsigned char>(header));
+                   }
+               });
+    ASSERT_EQ(full_res, midstate_res);
+}
+
+static PackStream make_scrypt_header(int n)
+{
+    vector<unsigned char> header(80);
+    for (int i = 0; i < 80; i++)
+    {
+        header[i] = (i * 31 + 7 + n) & 0xff;
+    }
+    return PackStream(header);
+}
+
+TEST(BitcoindDataTest, ScryptPowFunc)
+{
+    coind::DigibyteParentNetwork net;
+    //hashlib.scrypt(header, salt=header, n=1024, r=1, p=1, dklen=32)
+    auto header = make_scrypt_header(0);
+    auto pow_hash = net.POW_FUNC(header);
+    ASSERT_EQ(HexStr(pow_hash.begin(), pow_hash.end()), "71c1c19a7b0a7dba0e1a33b5db7bc9a726031b05f4d4cca0f62c157d93a5edda");
+
+    PackStream short_header(vector<unsigned char>(79));
+    ASSERT_THROW(net.POW_FUNC(short_header), std::invalid_argument);
+}
+
+TEST(BitcoindDataTest, ScryptPowFuncManyVsPowFunc)
+{
+    coind::DigibyteParentNetwork net;
+    for (auto count : {1, 3, 8, 13, bench_size(17, 200)})
+    {
+        vector<PackStream> headers;
+        for (int i = 0; i < count; i++)
+        {
+            headers.push_back(make_scrypt_header(i));
+        }
+
+        vector<uint256> single, many;
+        compare_ms(to_string(count) + " headers, POW_FUNC vs POW_FUNC_many", [&]()
+                   {
+                       for (auto &header : headers)
+                           single.push_back(net.POW_FUNC(header));
+                   },
+                   [&]()
+                   { many = net.POW_FUNC_many(headers); });
+        ASSERT_EQ(many, single);
+    }
+}
+
+TEST(BitcoindDataTest, PowCache)
+{
+    coind::DigibyteParentNetwork net;
+    const int count = 100;
+    vector<PackStream> headers;
+    for (int i = 0; i < count; i++)
+    {
+        headers.push_back(make_scrypt_header(i));
+    }
+
+    vector<uint256> computed, cached;
+    compare_ms(to_string(count) + " headers, pow_hash vs cached", [&]()
+               {
+                   for (auto &header : headers)
+                       computed.push_back(net.pow_hash(header));
+               },
+               [&]()
+               {
+                   for (auto &header : headers)
+                       cached.push_back(net.pow_hash(header));
+               });
+    ASSERT_EQ(cached, computed);
+    ASSERT_EQ(net.pow_cache.size(), count);
+    ASSERT_TRUE(net.pow_cache.is_dirty());
+
+    //pow_hash_many: cached headers aren't hashed again, missed ones are put.
+    vector<PackStream> batch(headers.begin(), headers.begin() + 10);
+    for (int i = 0; i < 5; i++)
+    {
+        batch.push_back(make_scrypt_header(count + i));
+    }
+    auto batch_res = net.pow_hash_many(batch);
+    ASSERT_EQ(net.pow_cache.size(), count + 5);
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        ASSERT_EQ(batch_res[i], net.POW_FUNC(batch[i]));
+    }
+
+    //restart: cache from file; nothing new to save after it.
+    ASSERT_TRUE(net.pow_cache.save("pow_cache_test.pow"));
+    ASSERT_FALSE(net.pow_cache.is_dirty());
+    coind::PowCache loaded;
+    ASSERT_EQ(loaded.load("pow_cache_test.pow"), count + 5);
+    ASSERT_FALSE(loaded.is_dirty());
+    for (int i = 0; i < count; i++)
+    {
+        uint256 pow_hash;
+        ASSERT_TRUE(loaded.get(coind::PowCache::header_hash(headers[i]), pow_hash));
+        ASSERT_EQ(pow_hash, computed[i]);
+    }
+    std::remove("pow_cache_test.pow");
+
+    //bounded: oldest evicted.
+    coind::PowCache small(coind::PowCache::shards_count);
+    for (int i = 0; i < count; i++)
+    {
+        small.put(coind::PowCache::header_hash(headers[i]), computed[i]);
+    }
+    ASSERT_LE(small.size(), coind::PowCache::shards_count);
+}
+
+TEST(BitcoindDataTest, FloatingInteger)
+{
+    ASSERT_EQ(FloatingInteger(0x1d00ffff).target(), CreateUINT256("00000000ffff0000000000000000000000000000000000000000000000000000"));
+    ASSERT_EQ(FloatingInteger(0x1b0404cb).target(), CreateUINT256("00000000000404cb000000000000000000000000000000000000000000000000"));
+    ASSERT_EQ(FloatingInteger(0x02008000).target(), CreateUINT256("80"));
+
+    for (auto bits : {0x1d00ffff, 0x1b0404cb, 0x1e0fffff, 0x207fffff})
+    {
+        ASSERT_EQ(FloatingInteger::from_target_upper_bound(FloatingInteger(bits).target()).bits.value, bits);
+    }
+    //0 before byte >= 0x80
+    ASSERT_EQ(FloatingInteger::from_target_upper_bound(CreateUINT256("80")).bits.value, 0x02008000);
+}
+
+TEST(BitcoindDataTest, Conversions)
+{
+    //2**256 // (target + 1)
+    ASSERT_EQ(coind::data::target_to_average_attempts(FloatingInteger(0x1d00ffff).target()), CreateUINT256("100010001"));
+    ASSERT_EQ(coind::data::target_to_average_attempts(FloatingInteger(0x1b0404cb).target()), CreateUINT256("3fb3ab764c00"));
+    ASSERT_EQ(coind::data::target_to_average_attempts(FloatingInteger(0x207fffff).target()), CreateUINT256("2"));
+    ASSERT_EQ(coind::data::target_to_average_attempts(CreateUINT256("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff")), CreateUINT256("1"));
+
+    //round(2**256 / attempts) - 1
+    ASSERT_EQ(coind::data::average_attempts_to_target(CreateUINT256("3")), CreateUINT256("5555555555555555555555555555555555555555555555555555555555555554"));
+    ASSERT_EQ(coind::data::average_attempts_to_target(CreateUINT256("3e8")), CreateUINT256("004189374bc6a7ef9db22d0e5604189374bc6a7ef9db22d0e5604189374bc6a7"));
+    ASSERT_EQ(coind::data::average_attempts_to_target(CreateUINT256("2bdc545d6b4b87")), CreateUINT256("00000000000005d62fb04524be288d33c8cb211b20950cadddc80beb8712121d"));
+    ASSERT_THROW(coind::data::average_attempts_to_target(uint256()), std::invalid_argument);
+
+    ASSERT_EQ(coind::data::difficulty_to_target(CreateUINT256("1")), CreateUINT256("00000000ffff0000000000000000000000000000000000000000000000000000"));
+    ASSERT_EQ(coind::data::difficulty_to_target(CreateUINT256("3fb3")), CreateUINT256("00000000000404d1cc69ef7417ac7b849b8b2366976e3092702ef882fd991c35"));
+    ASSERT_DOUBLE_EQ(coind::data::target_to_difficulty(FloatingInteger(0x1b0404cb).target()), 16307.420938523983);
+}
+
+TEST(BitcoindDataTest, AverageAttemptsVsArithDivision)
+{
+    const int count = bench_size(1000, 100000);
+    vector<uint256> targets;
+    for (auto bits : {0x1d00ffff, 0x1b0404cb, 0x1e0fffff, 0x1c2a1115})
+    {
+        targets.push_back(FloatingInteger(bits).target());
+    }
+
+    //(2**256 - 1 - target) / (target + 1) + 1 with bitwise arith_uint256 division.
+    arith_uint256 arith_res, res;
+    compare_ms(to_string(count) + " target_to_average_attempts, arith_uint256 division vs memo + Knuth division", [&]()
+               {
+                   for (int i = 0; i < count; i++)
+                   {
+                       auto target = UintToArith256(targets[i % targets.size()]);
+                       arith_res += (~target) / (target + 1) + 1;
+                   }
+               },
+               [&]()
+               {
+                   for (int i = 0; i < count; i++)
+                   {
+                       res += UintToArith256(coind::data::target_to_average_attempts(targets[i % targets.size()]));
+                   }
+               });
+    ASSERT_EQ(res, arith_res);
+}
@@ -4,6 +4,11 @@
 #include <sstream>
 #include <iostream>
 #include <memory>
+#include <vector>
+#include <array>
+#include <map>
+#include <cstring>
+#include <thread>
 using namespace std;
 
 #include <boost/bind.hpp>
@@ -13,9 +18,17 @@ namespace ip = boost::asio::ip;
 
 #include <libcoind/p2p/p2p_socket.h>
 #include <libcoind/p2p/p2p_protocol.h>
+#include <libcoind/p2p/message_reader.h>
+#include <libcoind/p2p/message_writer.h>
+#include <libcoind/p2p/command_table.h>
+#include <libcoind/data.h>
+#include <btclibs/span.h>
+#include <btclibs/crypto/common.h>
 
 #include <networks/network.h>
 
+#include "../bench.h"
+
 class TestCoindNode
 {
 public:
@@ -81,9 +94,385 @@ protected:
     }
 };
 
-TEST_F(Coind_P2P, test_connection)
+//needs internet access and runs until peer disconnects: --gtest_also_run_disabled_tests to run it.
+TEST_F(Coind_P2P, DISABLED_test_connection)
 {
     // auto result = coind->GetBlockChainInfo();
     // cout << "getblockchaininfo.bestblockhash = " << result["bestblockhash"].get_str() << endl;
     // cout << result.write() << endl;
-}
\ No newline at end of file
+}
+
+using coind::p2p::MessageReader;
+
+class CoindMessageTest : public ::testing::Test
+{
+protected:
+    const vector<unsigned char> prefix{0xfa, 0xbf, 0xb5, 0xda};
+
+    //prefix + command + length + checksum + payload
+    vector<unsigned char> pack_message(const string &command, const vector<unsigned char> &payload) const
+    {
+        vector<unsigned char> msg(prefix);
+        unsigned char cmd[12] = {'\0'};
+        memcpy(cmd, command.data(), command.size());
+        msg.insert(msg.end(), cmd, cmd + 12);
+        for (int i = 0; i < 4; i++)
+            msg.push_back((payload.size() >> (8 * i)) & 0xff);
+        auto hash = coind::data::hash256(Span<const unsigned char>(payload));
+        msg.insert(msg.end(), hash.begin(), hash.begin() + 4);
+        msg.insert(msg.end(), payload.begin(), payload.end());
+        return msg;
+    }
+
+    static vector<unsigned char> make_payload(size_t size, int seed)
+    {
+        vector<unsigned char> payload(size);
+        for (size_t i = 0; i < size; i++)
+            payload[i] = i * 31 + seed;
+        return payload;
+    }
+
+    //feed data by chunks of chunk_size, like async_read_some.
+    static size_t feed(MessageReader &reader, const vector<unsigned char> &data, size_t chunk_size, const MessageReader::handler_type &handler)
+    {
+        size_t count = 0;
+        size_t pos = 0;
+        while (pos < data.size())
+        {
+            auto free_space = reader.prepare();
+            auto n = std::min({chunk_size, free_space.size(), data.size() - pos});
+            memcpy(free_space.data(), data.data() + pos, n);
+            reader.commit(n);
+            pos += n;
+            count += reader.frame(handler);
+        }
+        return count;
+    }
+};
+
+TEST_F(CoindMessageTest, FramesFragmentedStream)
+{
+    vector<vector<unsigned char>> payloads;
+    vector<unsigned char> stream;
+    for (int i = 0; i < 50; i++)
+    {
+        //big message grows buffer over initial capacity.
+        payloads.push_back(make_payload(i == 25 ? 200000 : i * 37, i));
+        auto msg = pack_message("cmd" + to_string(i), payloads.back());
+        stream.insert(stream.end(), msg.begin(), msg.end());
+    }
+
+    for (size_t chunk_size : {1, 7, 100, 4096, 1000000})
+    {
+        MessageReader reader(prefix.data(), prefix.size(), 1024);
+        size_t i = 0;
+        auto count = feed(reader, stream, chunk_size, [&](const char *command, Span<const unsigned char> payload)
+                          {
+                              ASSERT_LT(i, payloads.size());
+                              ASSERT_EQ(string(command, strnlen(command, 12)), "cmd" + to_string(i));
+                              ASSERT_EQ(vector<unsigned char>(payload.begin(), payload.end()), payloads[i]);
+                              i++;
+                          });
+        ASSERT_EQ(count, payloads.size());
+        ASSERT_EQ(reader.size(), 0);
+    }
+}
+
+TEST_F(CoindMessageTest, SkipsBrokenMessages)
+{
+    vector<unsigned char> stream = {1, 2, 3, 0xfa, 0xbf};
+    auto good1 = pack_message("good1", make_payload(10, 1));
+    stream.insert(stream.end(), good1.begin(), good1.end());
+
+    //wrong checksum
+    auto bad = pack_message("bad", make_payload(10, 2));
+    bad[prefix.size() + 16] ^= 0xff;
+    stream.insert(stream.end(), bad.begin(), bad.end());
+
+    //too big length
+    auto big = pack_message("big", {});
+    big[prefix.size() + 15] = 0x7f;
+    stream.insert(stream.end(), big.begin(), big.end());
+
+    auto good2 = pack_message("good2", make_payload(10, 3));
+    stream.insert(stream.end(), good2.begin(), good2.end());
+
+    MessageReader reader(prefix.data(), prefix.size());
+    vector<string> commands;
+    feed(reader, stream, 3, [&](const char *command, Span<const unsigned char> payload)
+         { commands.emplace_back(command, strnlen(command, 12)); });
+    ASSERT_EQ(commands, vector<string>({"good1", "good2"}));
+}
+
+TEST_F(CoindMessageTest, FrameManySmallMessages)
+{
+    const int count = bench_size(2000, 200000);
+    vector<unsigned char> stream;
+    for (int i = 0; i < count; i++)
+    {
+        auto msg = pack_message("ping", make_payload(8, i));
+        stream.insert(stream.end(), msg.begin(), msg.end());
+    }
+
+    //previous reader: five async_read and heap arrays for every message.
+    size_t per_field_count = 0;
+    MessageReader reader(prefix.data(), prefix.size());
+    size_t framed_count = 0;
+    compare_ms(to_string(count) + " messages, per-field reads vs MessageReader", [&]()
+               {
+                   size_t pos = 0;
+                   while (pos < stream.size())
+                   {
+                       auto read_field = [&](size_t len)
+                       {
+                           auto field = new unsigned char[len];
+                           memcpy(field, stream.data() + pos, len);
+                           pos += len;
+                           return field;
+                       };
+                       auto p = read_field(prefix.size());
+                       auto command = read_field(12);
+                       auto len = read_field(4);
+                       auto checksum = read_field(4);
+                       auto payload_len = ReadLE32(len);
+                       auto payload = read_field(payload_len);
+                       auto hash = coind::data::hash256(Span<const unsigned char>(payload, payload_len));
+                       if (memcmp(hash.begin(), checksum, 4) == 0)
+                       {
+                           PackStream raw(payload, payload_len);
+                           per_field_count++;
+                       }
+                       delete[] p;
+                       delete[] command;
+                       delete[] len;
+                       delete[] checksum;
+                       delete[] payload;
+                   }
+               },
+               [&]()
+               {
+                   framed_count = feed(reader, stream, 64 * 1024, [&](const char *command, Span<const unsigned char> payload)
+                                       {
+                                           PackStream raw(vector<unsigned char>(payload.begin(), payload.end()));
+                                       });
+               });
+
+    ASSERT_EQ(per_field_count, count);
+    ASSERT_EQ(framed_count, count);
+}
+
+TEST_F(CoindMessageTest, WriterBatchRoundTrip)
+{
+    coind::p2p::MessageWriter writer(prefix.data(), prefix.size());
+    vector<vector<unsigned char>> payloads;
+    for (int i = 0; i < 300; i++)
+    {
+        payloads.push_back(make_payload(i % 5 == 0 ? 0 : i * 3, i));
+        writer.push(("cmd" + to_string(i)).c_str(), PackStream(payloads.back()));
+    }
+
+    //batches of max_batch_size messages, one in flight.
+    vector<unsigned char> stream;
+    size_t batches = 0;
+    while (true)
+    {
+        auto &buffers = writer.next_batch();
+        if (buffers.empty())
+            break;
+        for (auto &buf : buffers)
+        {
+            auto data = (const unsigned char *) buf.data();
+            stream.insert(stream.end(), data, data + buf.size());
+        }
+        ASSERT_TRUE(writer.writing());
+        ASSERT_TRUE(writer.next_batch().empty());
+        writer.complete();
+        batches++;
+    }
+    ASSERT_EQ(batches, (payloads.size() + coind::p2p::MessageWriter::max_batch_size - 1) / coind::p2p::MessageWriter::max_batch_size);
+    ASSERT_FALSE(writer.writing());
+
+    MessageReader reader(prefix.data(), prefix.size());
+    size_t i = 0;
+    auto count = feed(reader, stream, 4096, [&](const char *command, Span<const unsigned char> payload)
+                      {
+                          ASSERT_EQ(string(command, strnlen(command, 12)), "cmd" + to_string(i));
+                          ASSERT_EQ(vector<unsigned char>(payload.begin(), payload.end()), payloads[i]);
+                          i++;
+                      });
+    ASSERT_EQ(count, payloads.size());
+}
+
+//timing only: socket and drain thread, run with C2POOL_BENCH.
+TEST_F(CoindMessageTest, GatherWriteLoopback)
+{
+    if (!bench_enabled())
+        GTEST_SKIP();
+
+    namespace ip = boost::asio::ip;
+    const int count = 50000;
+    vector<vector<unsigned char>> payloads;
+    for (int i = 0; i < count; i++)
+        payloads.push_back(make_payload(36, i));
+
+    boost::asio::io_context context;
+    ip::tcp::acceptor acceptor(context, ip::tcp::endpoint(ip::address_v4::loopback(), 0));
+    ip::tcp::socket client(context), server(context);
+    client.connect(acceptor.local_endpoint());
+    acceptor.accept(server);
+
+    //server drains expected bytes.
+    auto drain = [&](size_t total)
+    {
+        return std::thread([&server, total]()
+                           {
+                               vector<unsigned char> buf(64 * 1024);
+                               size_t received = 0;
+                               while (received < total)
+                                   received += server.read_some(boost::asio::buffer(buf));
+                           });
+    };
+
+    //previous writer: prefix and packed message by two writes.
+    size_t total = 0;
+    vector<vector<unsigned char>> packed;
+    for (auto &payload : payloads)
+    {
+        auto msg = pack_message("have_tx", payload);
+        packed.emplace_back(msg.begin() + prefix.size(), msg.end());
+        total += msg.size();
+    }
+
+    coind::p2p::MessageWriter writer(prefix.data(), prefix.size());
+    compare_ms(to_string(count) + " messages, two writes per message vs gather writes (with packing)", [&]()
+               {
+                   auto receiver = drain(total);
+                   for (auto &msg : packed)
+                   {
+                       boost::asio::write(client, boost::asio::buffer(prefix));
+                       boost::asio::write(client, boost::asio::buffer(msg));
+                   }
+                   receiver.join();
+               },
+               [&]()
+               {
+                   auto receiver = drain(total);
+                   for (auto &payload : payloads)
+                       writer.push("have_tx", PackStream(payload));
+                   while (true)
+                   {
+                       auto &buffers = writer.next_batch();
+                       if (buffers.empty())
+                           break;
+                       boost::asio::write(client, buffers);
+                       writer.complete();
+                   }
+                   receiver.join();
+               });
+}
+
+TEST_F(CoindMessageTest, BroadcastPackedOnce)
+{
+    const int peers_count = bench_size(4, 32);
+    const int count = bench_size(50, 2000);
+    vector<PackStream> payloads;
+    for (int i = 0; i < count; i++)
+        payloads.emplace_back(make_payload(2000, i));
+
+    //previous broadcast: every peer serializes and checksums message.
+    vector<coind::p2p::MessageWriter> per_peer_writers(peers_count, coind::p2p::MessageWriter(prefix.data(), prefix.size()));
+    vector<coind::p2p::MessageWriter> writers(peers_count, coind::p2p::MessageWriter(prefix.data(), prefix.size()));
+    compare_ms(to_string(count) + " messages to " + to_string(peers_count) + " peers, pack per peer vs pack once", [&]()
+               {
+                   for (auto &payload : payloads)
+                       for (auto &writer : per_peer_writers)
+                           writer.push("shares", PackStream(payload.data));
+               },
+               [&]()
+               {
+                   for (auto &payload : payloads)
+                   {
+                       auto packed = coind::p2p::PackedMessage::pack("shares", PackStream(payload.data));
+                       for (auto &writer : writers)
+                           writer.push(packed);
+                   }
+               });
+
+    //every peer gets same bytes.
+    auto written = [](coind::p2p::MessageWriter &writer)
+    {
+        vector<unsigned char> stream;
+        while (true)
+        {
+            auto &buffers = writer.next_batch();
+            if (buffers.empty())
+                break;
+            for (auto &buf : buffers)
+                stream.insert(stream.end(), (const unsigned char *) buf.data(), (const unsigned char *) buf.data() + buf.size());
+            writer.complete();
+        }
+        return stream;
+    };
+    auto expected = written(per_peer_writers[0]);
+    for (auto &writer : writers)
+        ASSERT_EQ(written(writer), expected);
+}
+
+using coind::p2p::messages::command_table;
+
+static_assert(command_table.indexed());
+static_assert(command_table.find(coind::p2p::CommandKey::from_name("headers"))->cmd == coind::p2p::messages::cmd_headers);
+static_assert(command_table.find(coind::p2p::CommandKey::from_name("error"))->cmd == coind::p2p::messages::cmd_error);
+static_assert(command_table.find(coind::p2p::CommandKey::from_name("remember_tx")) == nullptr);
+
+TEST_F(CoindMessageTest, CommandTableDispatch)
+{
+    using namespace coind::p2p::messages;
+    std::map<std::string, commands> by_name;
+    vector<array<char, 12>> headers;
+    for (int cmd = cmd_version; cmd <= cmd_headers; cmd++)
+    {
+        auto name = command_table.name((commands) cmd);
+        by_name[name] = (commands) cmd;
+
+        //header bytes -> enum -> header bytes
+        array<char, 12> header{};
+        memcpy(header.data(), name, strlen(name));
+        headers.push_back(header);
+        auto entry = command_table.find(coind::p2p::CommandKey::from_bytes(header.data()));
+        ASSERT_NE(entry, nullptr);
+        ASSERT_EQ(entry->cmd, cmd);
+        array<unsigned char, 12> packed{};
+        command_table.key((commands) cmd)->write(packed.data());
+        ASSERT_EQ(memcmp(packed.data(), header.data(), 12), 0);
+    }
+    ASSERT_STREQ(command_table.name(cmd_error), "error");
+
+    //unknown command and garbage after zero padding.
+    array<char, 12> unknown{'s', 'h', 'a', 'r', 'e', 's'};
+    ASSERT_EQ(command_table.find(coind::p2p::CommandKey::from_bytes(unknown.data())), nullptr);
+    array<char, 12> dirty{'p', 'i', 'n', 'g', 0, 'x'};
+    ASSERT_EQ(command_table.find(coind::p2p::CommandKey::from_bytes(dirty.data())), nullptr);
+
+    const int rounds = bench_size(1000, 2000000);
+    size_t map_sum = 0;
+    size_t table_sum = 0;
+    compare_ms(to_string(rounds) + " commands, std::map<std::string> vs command table", [&]()
+               {
+                   for (int i = 0; i < rounds; i++)
+                   {
+                       auto &header = headers[i % headers.size()];
+                       std::string cmd(header.data(), strnlen(header.data(), 12));
+                       map_sum += by_name.at(cmd);
+                   }
+               },
+               [&]()
+               {
+                   for (int i = 0; i < rounds; i++)
+                   {
+                       auto &header = headers[i % headers.size()];
+                       table_sum += command_table.find(coind::p2p::CommandKey::from_bytes(header.data()))->cmd;
+                   }
+               });
+    ASSERT_EQ(map_sum, table_sum);
+}
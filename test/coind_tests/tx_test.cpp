@@ -68,9 +68,11 @@ TEST(CoindTxs, tx_hash)
 //    std::cout << std::endl;
 
     auto hash_tx = coind::data::hash256(result);
-    std::cout << "HexStr: " << HexStr(hash_tx.begin(), hash_tx.end()) << std::endl;
+    std::cout << "GetHex: " << hash_tx.GetHex() << std::endl;
 
-    ASSERT_EQ(HexStr(hash_tx.begin(), hash_tx.end()), "b53802b2333e828d6532059f46ecf6b313a42d79f97925e457fbbfda45367e5c");
+    // digest bytes are stored as is: GetHex == hex(hash256(data)) in p2pool.
+    ASSERT_EQ(hash_tx.GetHex(), "b53802b2333e828d6532059f46ecf6b313a42d79f97925e457fbbfda45367e5c");
+    ASSERT_EQ(HexStr(hash_tx.begin(), hash_tx.end()), "5c7e3645dabffb57e42579f9792da413b3f6ec469f0532658d823e33b20238b5");
 
     auto arith_hash_tx2 = UintToArith256(hash_tx);
     arith_hash_tx2 += 1;
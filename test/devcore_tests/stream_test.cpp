@@ -111,4 +111,133 @@ TEST(Devcore_stream, type_str)
 	StrType str2;
 	stream >> str2;
 	ASSERT_EQ(str2.get(), "asd123");
-}
\ No newline at end of file
+}
+TEST(Devcore_stream, read_cursor)
+{
+	PackStream stream;
+	IntType(32) num1(0xdeadbeef);
+	IntType(64) num2(0x0102030405060708);
+	uint64_t varint = 0x10000;
+	StrType str1(vector<unsigned char>{0x00, 0xfd, 0xfe, 0xff, 0x41});
+	stream << num1 << varint << str1 << num2;
+	auto full_size = stream.size();
+
+	IntType(32) unpacked_num1;
+	uint64_t unpacked_varint;
+	stream >> unpacked_num1 >> unpacked_varint;
+	ASSERT_EQ(unpacked_num1.get(), 0xdeadbeef);
+	ASSERT_EQ(unpacked_varint, 0x10000);
+	// data not erased, only cursor moved
+	ASSERT_EQ(stream.data.size(), full_size);
+	ASSERT_EQ(stream.size(), full_size - 4 - 5);
+
+	StrType unpacked_str;
+	IntType(64) unpacked_num2;
+	stream >> unpacked_str >> unpacked_num2;
+	ASSERT_EQ(unpacked_str.value, str1.value);
+	ASSERT_EQ(unpacked_num2.get(), 0x0102030405060708);
+	ASSERT_TRUE(stream.isNull());
+
+	ASSERT_THROW(stream >> unpacked_num1, std::out_of_range);
+}
+
+TEST(Devcore_stream, packed_size)
+{
+	uint256 num;
+	num.SetHex(hex_num);
+	IntType(256) packed_num(num);
+	IntType(32) num32(123);
+	uint64_t varint = 0x1000000;
+	StrType str1(std::string(300, 'a'));
+	ListType<IntType(256)> nums(ListType<IntType(256)>::make_type(vector<uint256>(10, num)));
+
+	auto size = PackStream::packed_size(packed_num) + PackStream::packed_size(num32) + PackStream::packed_size(varint) +
+				PackStream::packed_size(str1) + PackStream::packed_size(nums);
+	ASSERT_EQ(size, 32 + 4 + 5 + (3 + 300) + (1 + 10 * 32));
+
+	PackStream stream;
+	stream.pack(packed_num).pack(num32).pack(varint).pack(str1).pack(nums);
+	ASSERT_EQ(stream.size(), size);
+}
+
+TEST(Devcore_stream, fixed_layout)
+{
+	using c2pool::messages::stream::addr_stream;
+	static_assert(FixedSizeType<addr_stream>);
+	static_assert(addr_stream::fixed_size == 8 + 8 + 16 + 2);
+	static_assert(addr_stream::layout::offsets[1] == 8);
+
+	addr_stream addr;
+	addr.timestamp = 1629000000;
+	addr.address.services = 1;
+	addr.address.address = "192.168.50.31";
+	addr.address.port = 5024;
+
+	PackStream stream;
+	stream << addr;
+	ASSERT_EQ(stream.size(), addr_stream::fixed_size);
+	ASSERT_EQ(PackStream::packed_size(addr), addr_stream::fixed_size);
+	// port is big endian
+	ASSERT_EQ(stream.data[32], 5024 >> 8);
+	ASSERT_EQ(stream.data[33], 5024 & 0xff);
+
+	addr_stream unpacked_addr;
+	stream >> unpacked_addr;
+	ASSERT_EQ(unpacked_addr.timestamp.get(), 1629000000);
+	ASSERT_EQ(unpacked_addr.address.services.get(), 1);
+	ASSERT_EQ(unpacked_addr.address.address.get(), "192.168.50.31");
+	ASSERT_EQ(unpacked_addr.address.port.get(), 5024);
+}
+
+TEST(Devcore_stream, varint)
+{
+	vector<uint64_t> values = {0, 0xfc, 0xfd, 0xffff, 0x10000, 0xffffffff, 0x100000000, 0xffffffffffffffff};
+	vector<size_t> sizes = {1, 1, 3, 3, 5, 5, 9, 9};
+
+	PackStream stream;
+	for (int i = 0; i < values.size(); i++)
+	{
+		PackStream packed;
+		packed << values[i];
+		ASSERT_EQ(packed.size(), sizes[i]);
+		stream << values[i];
+	}
+
+	for (auto v : values)
+	{
+		uint64_t unpacked;
+		stream >> unpacked;
+		ASSERT_EQ(unpacked, v);
+	}
+}
+
+TEST(Devcore_stream, list_type_bulk)
+{
+	vector<uint256> nums(1000);
+	for (int i = 0; i < nums.size(); i++)
+	{
+		nums[i] = ArithToUint256(arith_uint256(i * 7919 + 1));
+	}
+	ListType<IntType(256)> packed_nums(ListType<IntType(256)>::make_type(nums));
+	ListType<unsigned char> packed_bytes(vector<unsigned char>{0x00, 0xfd, 0xfe, 0xff});
+
+	PackStream stream;
+	stream << packed_nums << packed_bytes;
+	ASSERT_EQ(stream.size(), 3 + 32 * 1000 + 1 + 4);
+
+	ListType<IntType(256)> unpacked_nums;
+	ListType<unsigned char> unpacked_bytes;
+	stream >> unpacked_nums >> unpacked_bytes;
+	ASSERT_EQ(unpacked_nums.l.size(), nums.size());
+	for (int i = 0; i < nums.size(); i++)
+	{
+		ASSERT_EQ(unpacked_nums.l[i].get(), nums[i]);
+	}
+	ASSERT_EQ(unpacked_bytes.l, packed_bytes.l);
+
+	// list length larger than data
+	PackStream bad_stream;
+	uint64_t bad_len = 1000000;
+	bad_stream << bad_len;
+	ASSERT_THROW(bad_stream >> unpacked_nums, std::out_of_range);
+}
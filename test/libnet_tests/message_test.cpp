@@ -6,6 +6,11 @@
 using std::make_shared;
 using namespace c2pool::libnet::messages;
 
+static_assert(command_table.indexed());
+static_assert(command_table.find(coind::p2p::CommandKey::from_name("remember_tx"))->cmd == cmd_remember_tx);
+static_assert(command_table.find(coind::p2p::CommandKey::from_name("forget_tx"))->cmd == cmd_forget_tx);
+static_assert(command_table.find(coind::p2p::CommandKey::from_name("error"))->cmd == cmd_error);
+static_assert(command_table.find(coind::p2p::CommandKey::from_name("getblocks")) == nullptr);
 
 
 TEST(LIBNET_MESSAGES, version)
@@ -1,12 +1,23 @@
 #include <gtest/gtest.h>
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
+#include <random>
+#include <cstring>
+#include <iostream>
 
 #include <sharechains/tracker.h>
+#include <sharechains/prefsum_share.h>
+#include <sharechains/hash_index.h>
+#include <sharechains/weights_skiplist.h>
+#include <sharechains/share_tx_index.h>
 #include <networks/network.h>
 
+#include "../bench.h"
+
 using namespace std;
+using namespace c2pool::shares;
 
 class TestParentNetwork : public coind::ParentNetwork
 {
@@ -46,9 +57,13 @@ public:
         IDENTIFIER = new unsigned char[8]{0x83, 0xE6, 0x5D, 0x2C, 0x81, 0xBF, 0x6D, 0x68};
         MINIMUM_PROTOCOL_VERSION = 1600;
         SEGWIT_ACTIVATION_VERSION = 17;
+        CHAIN_LENGTH = 24 * 60 * 60 / 10;
+        REAL_CHAIN_LENGTH = 24 * 60 * 60 / 10;
     }
 };
 
+static const char *valid_share_contents = "21fd4301fe020000209de9671e01aa0f06737b5aba0d547efb3064f8e8c5895e83d862169f5a46dd91bde1a36171b8001bc30a5e6eeba44141049c3f9d8453e73a0801db121e198af36ccb8c56d25c26af7e688a823d0471f4d6002cfabe6d6d5b57ca3c49353a085f40e3d5375e569349a5d6e3478f167df08a2c648e2f208b01000000000000000a5f5f6332706f6f6c5f5f8d1f6b9f9ad7bdd0e20eb7f64fa6dd42734dd4f43275cc26609753310b00000000000021000000000000000000000000000000000000000000000000000000000000000000000096f9718dd7d3ed68299d04c111d3bfb03f251d84b5b77737280a7625a4cddeb245d6011dffac0f1cbde1a361c8e614004170dc4fc36d88020000000000000000000000000005000000f60044fe657dce736492e948bdfc2894befdd62cf1641cea82fe75c1fd0197d8fd7a0100";
+
 struct TestShare
 {
     arith_uint256 hash;
@@ -63,6 +78,10 @@ protected:
     vector<TestShare> _items;
 
     std::shared_ptr<ShareTracker> tracker;
+    shared_ptr<BaseShare> prototype;
+    //shares in chains of prefsum tests
+    const int32_t chain_length = bench_size(500, 20000);
+    const int32_t queries = bench_size(100, 1000);
 protected:
     void SetUp()
     {
@@ -89,6 +108,177 @@ protected:
     {
         _items.clear();
     }
+
+    //copy of prototype share (from ValidLoadShareTest) with new hash/previous_hash.
+    shared_ptr<BaseShare> make_share(uint256 hash, uint256 previous_hash)
+    {
+        if (!prototype)
+        {
+            UniValue share_type(UniValue::VOBJ);
+            share_type.pushKV("type", 17);
+            share_type.pushKV("contents", valid_share_contents);
+
+            c2pool::libnet::addr _addr("255.255.255.255", "1234");
+            prototype = c2pool::shares::load_share(share_type, net, _addr);
+        }
+        auto share = std::make_shared<Share>(*std::static_pointer_cast<Share>(prototype));
+        share->hash = hash;
+        share->previous_hash = previous_hash;
+        return share;
+    }
+
+    //chain[0] — tail, chain[length-1] — head
+    vector<uint256> make_chain(PrefsumShare &prefsum, int32_t length)
+    {
+        vector<uint256> chain;
+        arith_uint256 prev_hash(0xdead);
+        for (int32_t i = 1; i <= length; i++)
+        {
+            auto hash = ArithToUint256(arith_uint256(i));
+            prefsum.add(make_share(hash, ArithToUint256(prev_hash)));
+            chain.push_back(hash);
+            prev_hash = UintToArith256(hash);
+        }
+        return chain;
+    }
+
+    //same chain, but added from head to tail, like shares from sharereply: every add attach orphan chain.
+    vector<uint256> make_chain_reversed(PrefsumShare &prefsum, int32_t length)
+    {
+        vector<uint256> chain;
+        for (int32_t i = 1; i <= length; i++)
+        {
+            chain.push_back(ArithToUint256(arith_uint256(i)));
+        }
+        for (int32_t i = length; i >= 1; i--)
+        {
+            auto prev_hash = (i == 1) ? arith_uint256(0xdead) : arith_uint256(i - 1);
+            prefsum.add(make_share(chain[i - 1], ArithToUint256(prev_hash)));
+        }
+        return chain;
+    }
+
+    //old implementation of get_height: walk by prev to the tail.
+    static int32_t linear_height(PrefsumShare &prefsum, uint256 hash)
+    {
+        int32_t height = 0;
+        auto pos = prefsum.sum.find_index(hash);
+        while (pos != PrefsumShare::npos)
+        {
+            height += 1;
+            pos = prefsum.sum.get(pos).second.prev;
+        }
+        return height;
+    }
+
+    //old implementation of get_nth_parent_hash: walk by prev one share at a time.
+    static uint256 linear_nth_parent_hash(PrefsumShare &prefsum, uint256 hash, int32_t n)
+    {
+        if (n == 0)
+            return hash;
+        auto pos = prefsum.sum.find_index(hash);
+        for (int32_t dist = 1; dist < n; dist++)
+        {
+            pos = prefsum.sum.get(pos).second.prev;
+        }
+        return prefsum.sum.get(pos).second.prev_hash();
+    }
+
+    //p2pool get_cumulative_weights without skip list: apply_delta share by share, the last share counts partially.
+    static CumulativeWeights linear_cumulative_weights(PrefsumShare &prefsum, uint256 start, int32_t max_shares, arith_uint256 desired_weight)
+    {
+        CumulativeWeights res;
+        for (int32_t i = 0; i < max_shares && res.total_weight < desired_weight && prefsum.exists(start); i++)
+        {
+            weights_delta delta(prefsum.items.at(start));
+            if (res.total_weight + delta.total_weight > desired_weight)
+            {
+                //(desired_weight - total_weight1)//65535*weights2[script]//(total_weight2//65535)
+                auto part = (desired_weight - res.total_weight) / 65535;
+                for (auto &weight : delta.weights)
+                    res.weights[weight.first] += part * weight.second / (delta.total_weight / 65535);
+                res.donation_weight += part * delta.total_donation_weight / (delta.total_weight / 65535);
+                res.total_weight = desired_weight;
+                break;
+            }
+            for (auto &weight : delta.weights)
+                res.weights[weight.first] += weight.second;
+            res.total_weight += delta.total_weight;
+            res.donation_weight += delta.total_donation_weight;
+            start = prefsum.items.at(start)->previous_hash;
+        }
+        return res;
+    }
+
+    //20 miners with different donations.
+    static void set_miners(PrefsumShare &prefsum, const vector<uint256> &chain)
+    {
+        for (int32_t i = 0; i < (int32_t) chain.size(); i++)
+        {
+            auto share = prefsum.items.at(chain[i]);
+            share->pubkey_hash = uint160();
+            *share->pubkey_hash.begin() = i % 20;
+            share->donation = i % 100;
+        }
+    }
+
+    //old t1 of generate_share_transactions: walk 100 shares from head.
+    static map<uint256, tuple<int, int>> rebuild_tx_hash_to_this(PrefsumShare &prefsum, uint256 head)
+    {
+        map<uint256, tuple<int, int>> res;
+        auto get_chain = prefsum.get_chain(head, std::min(prefsum.get_height(head), ShareTxIndex::window_size));
+        uint256 hash;
+        int32_t i = 0;
+        while (get_chain(hash))
+        {
+            auto &tx_hashes = prefsum.items.at(hash)->new_transaction_hashes;
+            for (int32_t j = 0; j < (int32_t) tx_hashes.size(); j++)
+            {
+                if (res.find(tx_hashes[j]) == res.end())
+                    res[tx_hashes[j]] = std::make_tuple(1 + i, j);
+            }
+            i += 1;
+        }
+        return res;
+    }
+
+    static void check_tx_hash_to_this(ShareTxIndex &tx_hash_to_this, const map<uint256, tuple<int, int>> &expected)
+    {
+        ASSERT_EQ(tx_hash_to_this.size(), expected.size());
+        for (auto &tx : expected)
+        {
+            tuple<int, int> _this;
+            ASSERT_TRUE(tx_hash_to_this.get(tx.first, _this));
+            ASSERT_EQ(_this, tx.second);
+        }
+    }
+
+    //txs_per_share own txs + first tx of the parent: newer share keeps the shared tx.
+    static void set_txs(PrefsumShare &prefsum, const vector<uint256> &chain, int32_t txs_per_share, int32_t salt = 0)
+    {
+        for (int32_t i = 0; i < (int32_t) chain.size(); i++)
+        {
+            vector<uint256> tx_hashes;
+            for (int32_t j = 0; j < txs_per_share; j++)
+                tx_hashes.push_back(ArithToUint256((arith_uint256(i * txs_per_share + j) << 128) + 7 + salt));
+            if (i > 0)
+                tx_hashes.push_back(ArithToUint256((arith_uint256((i - 1) * txs_per_share) << 128) + 7 + salt));
+            prefsum.items.at(chain[i])->new_transaction_hashes = tx_hashes;
+        }
+    }
+
+    //old implementation of get_last.
+    static uint256 linear_get_last(PrefsumShare &prefsum, uint256 hash)
+    {
+        auto pos = prefsum.sum.find_index(hash);
+        uint256 last;
+        while (pos != PrefsumShare::npos)
+        {
+            last = prefsum.sum.get(pos).second.prev_hash();
+            pos = prefsum.sum.get(pos).second.prev;
+        }
+        return last;
+    }
 };
 
 TEST_F(ShareTrackerTest, InitTrackerTest)
@@ -119,7 +309,7 @@ TEST_F(ShareTrackerTest, ValidLoadShareTest)
     UniValue share_type(UniValue::VOBJ);
 
     share_type.pushKV("type", 17);
-    share_type.pushKV("contents", "21fd4301fe020000209de9671e01aa0f06737b5aba0d547efb3064f8e8c5895e83d862169f5a46dd91bde1a36171b8001bc30a5e6eeba44141049c3f9d8453e73a0801db121e198af36ccb8c56d25c26af7e688a823d0471f4d6002cfabe6d6d5b57ca3c49353a085f40e3d5375e569349a5d6e3478f167df08a2c648e2f208b01000000000000000a5f5f6332706f6f6c5f5f8d1f6b9f9ad7bdd0e20eb7f64fa6dd42734dd4f43275cc26609753310b00000000000021000000000000000000000000000000000000000000000000000000000000000000000096f9718dd7d3ed68299d04c111d3bfb03f251d84b5b77737280a7625a4cddeb245d6011dffac0f1cbde1a361c8e614004170dc4fc36d88020000000000000000000000000005000000f60044fe657dce736492e948bdfc2894befdd62cf1641cea82fe75c1fd0197d8fd7a0100");
+    share_type.pushKV("contents", valid_share_contents);
 
     c2pool::libnet::addr _addr("255.255.255.255", "1234");
     auto share = c2pool::shares::load_share(share_type, net, _addr);
@@ -177,4 +367,438 @@ TEST_F(ShareTrackerTest, CreateAddShareToTracker){
     result.pushKV("last_txout_nonce", last_txout_nonce);
     result.pushKV("hash_link", (UniValue) hash_link);
     result.pushKV("merkle_link", (UniValue) merkle_link);
-}
\ No newline at end of file
+}
+
+TEST_F(ShareTrackerTest, NthParentSkipListVsLinear)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, chain_length);
+    auto head = chain.back();
+
+    vector<uint256> linear_res, skip_res;
+    compare_ms("get_nth_parent_hash x" + to_string(queries) + " on " + to_string(chain_length) + " shares, linear vs skip list", [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       linear_res.push_back(linear_nth_parent_hash(prefsum, head, chain_length / 2 - q));
+               },
+               [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       skip_res.push_back(prefsum.get_nth_parent_hash(head, chain_length / 2 - q));
+               });
+    ASSERT_EQ(linear_res, skip_res);
+}
+
+TEST_F(ShareTrackerTest, GetLastSkipListVsLinear)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, chain_length);
+
+    vector<uint256> linear_res, skip_res;
+    compare_ms("get_last x" + to_string(queries) + " on " + to_string(chain_length) + " shares, linear vs skip list", [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       linear_res.push_back(linear_get_last(prefsum, chain[chain.size() - 1 - q]));
+               },
+               [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       skip_res.push_back(prefsum.get_last(chain[chain.size() - 1 - q]));
+               });
+    ASSERT_EQ(linear_res, skip_res);
+}
+
+TEST_F(ShareTrackerTest, GetHeightCachedVsLinear)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain_reversed(prefsum, chain_length);
+
+    vector<int32_t> linear_res, cached_res;
+    compare_ms("get_height x" + to_string(queries) + " on " + to_string(chain_length) + " shares (added head first), linear vs cached", [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       linear_res.push_back(linear_height(prefsum, chain[chain.size() - 1 - q]));
+               },
+               [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       cached_res.push_back(prefsum.get_height(chain[chain.size() - 1 - q]));
+               });
+    ASSERT_EQ(linear_res, cached_res);
+    ASSERT_EQ(prefsum.get_last(chain.back()), ArithToUint256(arith_uint256(0xdead)));
+}
+
+TEST_F(ShareTrackerTest, BestHeadVsScan)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, chain_length);
+    //short forks from the middle of the chain
+    for (int32_t fork = 1; fork <= 10; fork++)
+    {
+        auto prev_hash = chain[chain.size() - 1 - fork * 20];
+        for (int32_t i = 1; i <= fork; i++)
+        {
+            auto hash = ArithToUint256(arith_uint256(1000000 * fork + i));
+            prefsum.add(make_share(hash, prev_hash));
+            prev_hash = hash;
+        }
+    }
+
+    vector<uint256> scan_res, best_res;
+    compare_ms("best head x" + to_string(queries) + " on " + to_string(chain_length) + " shares, scan vs heads/tails", [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                   {
+                       uint256 best;
+                       int32_t best_height = 0;
+                       for (auto &item : prefsum.items)
+                       {
+                           auto height = prefsum.get_height(item.first);
+                           if (height > best_height)
+                           {
+                               best_height = height;
+                               best = item.first;
+                           }
+                       }
+                       scan_res.push_back(best);
+                   }
+               },
+               [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       best_res.push_back(prefsum.get_best());
+               });
+
+    ASSERT_EQ(prefsum.heads.size(), 11u);
+    ASSERT_EQ(scan_res, best_res);
+    ASSERT_EQ(best_res[0], chain.back());
+}
+
+TEST_F(ShareTrackerTest, PruneTailVsRebuild)
+{
+    const int32_t pruned = chain_length / 2;
+
+    PrefsumShare rebuild;
+    auto chain = make_chain(rebuild, chain_length);
+    PrefsumShare prefsum;
+    make_chain(prefsum, chain_length);
+    compare_ms("remove " + to_string(pruned) + " tail shares of " + to_string(chain_length) + ", rebase vs prune_tail", [&]()
+               {
+                   //old cost of tail removal: every removed share is subtracted from all shares above it.
+                   for (int32_t i = 0; i < pruned; i++)
+                   {
+                       auto remover = rebuild.sum.get(rebuild.sum.find_index(chain[i])).second;
+                       auto pos = remover.next;
+                       while (pos != PrefsumShare::npos)
+                       {
+                           auto &element = rebuild.sum.get(pos).second;
+                           element -= remover;
+                           pos = element.next;
+                       }
+                   }
+               },
+               [&]()
+               { prefsum.prune_tail(chain.back(), pruned); });
+
+    ASSERT_EQ(prefsum.items.size(), (size_t) (chain_length - pruned));
+    //both ways give the same sums for the head.
+    auto &rebuilt_head = rebuild.sum.get(rebuild.sum.find_index(chain.back())).second;
+    ASSERT_EQ(rebuilt_head.height, prefsum.get_height(chain.back()));
+    ASSERT_EQ(ArithToUint256(rebuilt_head.work), prefsum.get_work(chain.back()));
+    ASSERT_EQ(prefsum.get_height(chain.back()), chain_length - pruned);
+    ASSERT_EQ(prefsum.get_last(chain.back()), chain[pruned - 1]);
+    ASSERT_EQ(prefsum.get_nth_parent_hash(chain.back(), 100), chain[chain.size() - 101]);
+    ASSERT_EQ(prefsum.get_best_head(chain[pruned - 1]), chain.back());
+
+    //one by one, like clean_tracker.
+    for (int32_t i = pruned; i < pruned + pruned / 2; i++)
+        prefsum.remove(chain[i]);
+    ASSERT_EQ(prefsum.get_height(chain.back()), chain_length - pruned - pruned / 2);
+}
+
+TEST_F(ShareTrackerTest, CumulativeWeightsSkipListVsLinear)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, chain_length);
+    set_miners(prefsum, chain);
+    WeightsSkipList get_cumulative_weights(prefsum);
+    auto desired_weight = UintToArith256(coind::data::target_to_average_attempts(prefsum.items.at(chain[0])->target)) * 65535 * net->REAL_CHAIN_LENGTH;
+
+    vector<CumulativeWeights> linear_res, skip_res;
+    compare_ms("get_cumulative_weights x" + to_string(queries) + " on " + to_string(chain_length) + " shares, linear vs skip list", [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       linear_res.push_back(linear_cumulative_weights(prefsum, chain[chain.size() - 1 - q], net->REAL_CHAIN_LENGTH - 1, desired_weight));
+               },
+               [&]()
+               {
+                   for (int32_t q = 0; q < queries; q++)
+                       skip_res.push_back(get_cumulative_weights(chain[chain.size() - 1 - q], net->REAL_CHAIN_LENGTH - 1, desired_weight));
+               });
+
+    for (int32_t q = 0; q < queries; q++)
+    {
+        //second query goes through cached skip nodes.
+        auto cached = get_cumulative_weights(chain[chain.size() - 1 - q], net->REAL_CHAIN_LENGTH - 1, desired_weight);
+        ASSERT_EQ(linear_res[q].weights, skip_res[q].weights);
+        ASSERT_EQ(linear_res[q].total_weight, skip_res[q].total_weight);
+        ASSERT_EQ(linear_res[q].donation_weight, skip_res[q].donation_weight);
+        ASSERT_EQ(cached.weights, skip_res[q].weights);
+        ASSERT_EQ(cached.total_weight, skip_res[q].total_weight);
+    }
+}
+
+TEST_F(ShareTrackerTest, CumulativeWeightsPartialLastShare)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, 300);
+    set_miners(prefsum, chain);
+    WeightsSkipList get_cumulative_weights(prefsum);
+    auto att = UintToArith256(coind::data::target_to_average_attempts(prefsum.items.at(chain[0])->target));
+
+    //desired_weight ends inside share k + 1 (or exactly at its end for part == att): only part of it is counted.
+    for (int32_t k : {0, 1, 7, 64, 250})
+    {
+        for (arith_uint256 part : vector<arith_uint256>{1, att / 3, att - 1, att})
+        {
+            auto desired_weight = (att * k + part) * 65535;
+            for (int32_t q : {0, 1, 17})
+            {
+                auto start = chain[chain.size() - 1 - q];
+                auto linear = linear_cumulative_weights(prefsum, start, 299, desired_weight);
+                auto skip = get_cumulative_weights(start, 299, desired_weight);
+                ASSERT_EQ(skip.total_weight, desired_weight);
+                ASSERT_EQ(skip.weights, linear.weights);
+                ASSERT_EQ(skip.total_weight, linear.total_weight);
+                ASSERT_EQ(skip.donation_weight, linear.donation_weight);
+            }
+        }
+    }
+
+    //partial share: pubkey_hash of share k + 1 from start gets part/att of its weight.
+    auto desired_weight = (att * 2 + att / 4) * 65535;
+    auto res = get_cumulative_weights(chain.back(), 299, desired_weight);
+    auto third = prefsum.items.at(chain[chain.size() - 3]);
+    weights_delta full(third);
+    uint160 third_miner = third->pubkey_hash;
+    ASSERT_EQ(res.weights[third_miner], (att / 4) * full.weights[third_miner] / att);
+
+    ASSERT_THROW(get_cumulative_weights(chain.back(), 299, desired_weight + 1), std::invalid_argument);
+}
+
+TEST_F(ShareTrackerTest, CumulativeWeightsForgetsRemovedShares)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, 300);
+    set_miners(prefsum, chain);
+    WeightsSkipList get_cumulative_weights(prefsum);
+    auto att = UintToArith256(coind::data::target_to_average_attempts(prefsum.items.at(chain[0])->target));
+    auto desired_weight = att * 65535 * 1000;
+
+    //node for every share.
+    for (auto &hash : chain)
+        get_cumulative_weights(hash, 299, desired_weight);
+    ASSERT_EQ(get_cumulative_weights.size(), chain.size());
+
+    //skip nodes of pruned tail, removed root and removed middle share are released.
+    prefsum.prune_tail(chain.back(), 100);
+    prefsum.remove(chain[100]);
+    prefsum.remove(chain[150]);
+    ASSERT_EQ(get_cumulative_weights.size(), chain.size() - 102);
+
+    auto linear = linear_cumulative_weights(prefsum, chain.back(), 299, desired_weight);
+    auto skip = get_cumulative_weights(chain.back(), 299, desired_weight);
+    ASSERT_EQ(skip.weights, linear.weights);
+    ASSERT_EQ(skip.total_weight, linear.total_weight);
+    ASSERT_EQ(skip.donation_weight, linear.donation_weight);
+}
+
+TEST_F(ShareTrackerTest, TxHashToThisIncrementalVsRebuild)
+{
+    PrefsumShare prefsum;
+    const int32_t length = bench_size(170, 400);
+    const int32_t txs_per_share = bench_size(20, 2000);
+    auto chain = make_chain(prefsum, length);
+    set_txs(prefsum, chain, txs_per_share);
+    const int32_t first_head = 150;
+
+    map<uint256, tuple<int, int>> rebuild_res;
+    ShareTxIndex tx_hash_to_this(prefsum);
+    tx_hash_to_this.set_head(chain[first_head - 1]);
+    compare_ms("tx_hash_to_this for " + to_string(length - first_head) + " new best shares (" + to_string(txs_per_share) + " txs per share), rebuild vs incremental", [&]()
+               {
+                   for (int32_t head = first_head; head < length; head++)
+                       rebuild_res = rebuild_tx_hash_to_this(prefsum, chain[head]);
+               },
+               [&]()
+               {
+                   for (int32_t head = first_head; head < length; head++)
+                       tx_hash_to_this.set_head(chain[head]);
+               });
+    check_tx_hash_to_this(tx_hash_to_this, rebuild_res);
+}
+
+TEST_F(ShareTrackerTest, TxHashToThisReorg)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, 150);
+    set_txs(prefsum, chain, 5);
+    //fork of 40 shares from chain[80] with own txs.
+    vector<uint256> fork;
+    auto prev_hash = chain[80];
+    for (int32_t i = 1; i <= 40; i++)
+    {
+        auto hash = ArithToUint256(arith_uint256(1000000 + i));
+        prefsum.add(make_share(hash, prev_hash));
+        fork.push_back(hash);
+        prev_hash = hash;
+    }
+    set_txs(prefsum, fork, 5, 1000);
+
+    ShareTxIndex tx_hash_to_this(prefsum);
+    //forward, to other chain, back to main chain, to ancestor, to a descendant further than window.
+    for (auto head : {chain[120], fork.back(), chain[130], chain[100], fork[10], chain[149], chain[10]})
+    {
+        tx_hash_to_this.set_head(head);
+        check_tx_hash_to_this(tx_hash_to_this, rebuild_tx_hash_to_this(prefsum, head));
+    }
+}
+
+TEST_F(ShareTrackerTest, TxHashToThisExpiresRemovedShares)
+{
+    PrefsumShare prefsum;
+    auto chain = make_chain(prefsum, 150);
+    set_txs(prefsum, chain, 5);
+
+    ShareTxIndex tx_hash_to_this(prefsum);
+    tx_hash_to_this.set_head(chain[99]);
+    check_tx_hash_to_this(tx_hash_to_this, rebuild_tx_hash_to_this(prefsum, chain[99]));
+
+    //shares in the window removed from tracker: they are expired by full scan.
+    prefsum.prune_tail(chain.back(), 30);
+    tx_hash_to_this.set_head(chain[104]);
+    check_tx_hash_to_this(tx_hash_to_this, rebuild_tx_hash_to_this(prefsum, chain[104]));
+
+    tx_hash_to_this.set_head(chain[149]);
+    check_tx_hash_to_this(tx_hash_to_this, rebuild_tx_hash_to_this(prefsum, chain[149]));
+}
+
+TEST_F(ShareTrackerTest, AddManyVsAdd)
+{
+    //shares as from sharereply/ShareStore: head first.
+    vector<shared_ptr<BaseShare>> batch;
+    for (int32_t i = chain_length; i >= 1; i--)
+    {
+        auto prev_hash = (i == 1) ? arith_uint256(0xdead) : arith_uint256(i - 1);
+        batch.push_back(make_share(ArithToUint256(arith_uint256(i)), ArithToUint256(prev_hash)));
+    }
+
+    auto tracker = std::make_shared<ShareTracker>(net);
+    int32_t add_events = 0;
+    tracker->added.subscribe([&](std::vector<shared_ptr<BaseShare>> _shares)
+                             { add_events += 1; });
+    auto tracker_many = std::make_shared<ShareTracker>(net);
+    int32_t add_many_events = 0;
+    tracker_many->added.subscribe([&](std::vector<shared_ptr<BaseShare>> _shares)
+                                  { add_many_events += 1; });
+    compare_ms("load " + to_string(chain_length) + " shares, add vs add_many", [&]()
+               {
+                   for (auto &share : batch)
+                       tracker->add(share);
+               },
+               [&]()
+               { tracker_many->add_many(batch); });
+
+    ASSERT_EQ(add_events, chain_length);
+    ASSERT_EQ(add_many_events, 1);
+    ASSERT_EQ(tracker->shares.heads, tracker_many->shares.heads);
+    ASSERT_EQ(tracker_many->shares.get_height(batch.front()->hash), chain_length);
+    ASSERT_EQ(tracker_many->shares.get_work(batch.front()->hash), tracker->shares.get_work(batch.front()->hash));
+}
+
+class HashIndexTest : public ::testing::Test
+{
+protected:
+    //share hashes are uniform, like random.
+    static vector<uint256> make_hashes(size_t n)
+    {
+        std::mt19937_64 rng(n);
+        vector<uint256> res(n);
+        for (auto &hash : res)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                uint64_t word = rng();
+                std::memcpy(hash.begin() + i * 8, &word, 8);
+            }
+        }
+        return res;
+    }
+
+    //add, lookup x10, remove.
+    template <typename Index>
+    static void exercise(const vector<uint256> &hashes, size_t &found)
+    {
+        Index index;
+        auto value = std::make_shared<int>(0);
+        for (auto &hash : hashes)
+            index[hash] = value;
+        for (int round = 0; round < 10; round++)
+            for (auto &hash : hashes)
+                found += index.find(hash) != index.end();
+        for (auto &hash : hashes)
+            index.erase(hash);
+        ASSERT_TRUE(index.empty());
+    }
+};
+
+TEST_F(HashIndexTest, MapVsHashIndex)
+{
+    for (size_t n : {size_t(1), bench_size<size_t>(2000, 20000), bench_size<size_t>(5000, 200000)})
+    {
+        auto hashes = make_hashes(n);
+        size_t map_found = 0, index_found = 0;
+        compare_ms(to_string(n) + " shares, add + lookup x10 + remove, std::map vs HashIndex",
+                   [&]()
+                   { exercise<map<uint256, shared_ptr<int>>>(hashes, map_found); },
+                   [&]()
+                   { exercise<HashIndex<shared_ptr<int>>>(hashes, index_found); });
+        ASSERT_EQ(map_found, n * 10);
+        ASSERT_EQ(index_found, n * 10);
+    }
+}
+
+TEST_F(HashIndexTest, SequentialKeysVsMap)
+{
+    //low 64 bits of key are i: buckets come from high bits of product.
+    map<uint256, int> expected;
+    HashIndex<int> index;
+    index.reserve(100);
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < 3000; i++)
+        {
+            auto key = ArithToUint256(arith_uint256(i));
+            expected[key] = i + round;
+            index[key] = i + round;
+            //erase every third from the middle of the clusters.
+            if (i % 3 == 2)
+            {
+                auto erased = ArithToUint256(arith_uint256(i - 1));
+                expected.erase(erased);
+                index.erase(erased);
+            }
+        }
+        ASSERT_EQ(index.size(), expected.size());
+        for (int i = 0; i < 3000; i++)
+        {
+            auto key = ArithToUint256(arith_uint256(i));
+            auto it = index.find(key);
+            ASSERT_EQ(it != index.end(), expected.count(key) > 0);
+            if (it != index.end())
+                ASSERT_EQ(it->second, expected[key]);
+        }
+        index.clear();
+        expected.clear();
+    }
+}